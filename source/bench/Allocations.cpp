@@ -0,0 +1,34 @@
+#include "Allocations.hpp"
+
+#include <cstdlib>
+#include <atomic>
+#include <new>
+
+using namespace std;
+
+static atomic<size_t> allocations{0};
+
+size_t allocation_count()
+{
+	return allocations.load(memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, memory_order_relaxed);
+
+	if (void* p = malloc(size != 0 ? size : 1))
+		return p;
+
+	throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+/// \brief Number of global allocations made so far
+///
+/// The bench replaces the global operator new to count them.
+std::size_t allocation_count();
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ginseng.hpp"
+
+#include "Allocations.hpp"
+
+using namespace std;
+
+struct Position
+{
+	float x, y;
+};
+
+struct Velocity
+{
+	float x, y;
+};
+
+struct Frozen
+{ };
+
+using ListDB = ginseng::Database<>;
+using ArchetypeDB = ginseng::Database<allocator, ginseng::ArchetypeStorage>;
+using SparseDB = ginseng::Database<allocator, ginseng::SparseStorage>;
+
+/// Keeps results alive so the optimizer cannot drop the work
+static volatile float sink;
+
+struct Result
+{
+	double ns_per_entity;
+	double allocs_per_entity;
+};
+
+/// \brief Runs setup then run, until at least a million entities were processed
+///
+/// Only run is timed; the fastest repetition is kept.
+template<typename Setup, typename Run>
+static Result measure(size_t count, Setup&& setup, Run&& run)
+{
+	size_t reps = max<size_t>(3, 1000000 / count);
+	double best = numeric_limits<double>::max();
+	size_t allocs = 0;
+
+	for (size_t r = 0; r < reps; ++r)
+	{
+		setup();
+
+		size_t before = allocation_count();
+		auto start = chrono::steady_clock::now();
+
+		run();
+
+		auto stop = chrono::steady_clock::now();
+		allocs += allocation_count() - before;
+
+		best = min(best, chrono::duration<double, nano>(stop - start).count());
+	}
+
+	return {best / count, double(allocs) / reps / count};
+}
+
+template<typename Run>
+static Result measure(size_t count, Run&& run)
+{
+	return measure(count, [] { }, forward<Run>(run));
+}
+
+static void report(char const* storage, char const* name, size_t count, Result r)
+{
+	printf("%-10s %-22s %9zu %12.2f %12.3f\n", storage, name, count, r.ns_per_entity, r.allocs_per_entity);
+	fflush(stdout);
+}
+
+/// \brief Fills a database with count entities
+///
+/// Every entity has a Position, every other one a Velocity and every fourth
+/// one is Frozen.
+template<typename DB>
+static vector<typename DB::EntID> populate(DB& db, size_t count)
+{
+	vector<typename DB::EntID> eids;
+	eids.reserve(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto eid = db.create_entity();
+		db.create_component(eid, Position{float(i), 0.f});
+
+		if (i % 2 == 0)
+			db.create_component(eid, Velocity{1.f, 2.f});
+
+		if (i % 4 == 0)
+			db.create_component(eid, ginseng::Tag<Frozen>{});
+
+		eids.push_back(eid);
+	}
+
+	return eids;
+}
+
+template<typename DB>
+static void run_storage(char const* storage, size_t count)
+{
+	using EntID = typename DB::EntID;
+
+	// Entities are created and destroyed in full every repetition
+	{
+		vector<EntID> eids;
+		eids.reserve(count);
+		DB db;
+
+		report(storage, "create/destroy", count, measure(count, [&]
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				auto eid = db.create_entity();
+				db.create_component(eid, Position{float(i), 0.f});
+				eids.push_back(eid);
+			}
+
+			for (auto eid : eids)
+				db.erase_entity(eid);
+
+			eids.clear();
+		}));
+	}
+
+	DB db;
+	auto eids = populate(db, count);
+
+	// Components are added to entities that do not have one yet
+	{
+		vector<EntID> bare;
+		for (auto eid : eids)
+			if (!db.template get<Velocity>(eid))
+				bare.push_back(eid);
+
+		report(storage, "create_component", bare.size(), measure(bare.size(), [&]
+		{
+			for (auto eid : bare)
+				if (auto com = db.template get<Velocity>(eid))
+					db.erase_component(com.id());
+		}, [&]
+		{
+			for (auto eid : bare)
+				db.create_component(eid, Velocity{0.f, 1.f});
+		}));
+
+		for (auto eid : bare)
+			db.erase_component(db.template get<Velocity>(eid).id());
+	}
+
+	// Random order defeats the prefetcher, as lookups by EntID usually do
+	{
+		auto shuffled = eids;
+		shuffle(begin(shuffled), end(shuffled), mt19937(42));
+
+		report(storage, "get<T> (random)", count, measure(count, [&]
+		{
+			float sum = 0;
+			for (auto eid : shuffled)
+				sum += db.template get<Position>(eid).data().x;
+			sink = sum;
+		}));
+	}
+
+	report(storage, "visit 1 component", count, measure(count, [&]
+	{
+		db.visit([](Position& p) { p.x += 1.f; });
+	}));
+
+	report(storage, "visit 2 components", count, measure(count, [&]
+	{
+		db.visit([](Position& p, Velocity const& v)
+		         {
+			         p.x += v.x;
+			         p.y += v.y;
+		         });
+	}));
+
+	report(storage, "visit Not<>", count, measure(count, [&]
+	{
+		db.visit([](Position& p, ginseng::Not<Velocity>) { p.y += 1.f; });
+	}));
+
+	report(storage, "visit Tag<>", count, measure(count, [&]
+	{
+		db.visit([](Position const& p, ginseng::Tag<Frozen>) { sink = p.x; });
+	}));
+
+	report(storage, "query()", count, measure(count, [&]
+	{
+		auto rows = db.template query<EntID, Position>();
+		sink = float(rows.size());
+	}));
+}
+
+int main(int argc, char** argv)
+{
+	vector<size_t> counts = {1000, 100000, 1000000};
+	string only = argc > 1 ? argv[1] : "";
+
+	printf("%-10s %-22s %9s %12s %12s\n", "storage", "benchmark", "entities", "ns/entity", "allocs/ent");
+
+	for (auto count : counts)
+	{
+		if (only.empty() || only == "list")
+			run_storage<ListDB>("list", count);
+
+		if (only.empty() || only == "archetype")
+			run_storage<ArchetypeDB>("archetype", count);
+
+		if (only.empty() || only == "sparse")
+			run_storage<SparseDB>("sparse", count);
+	}
+
+	return 0;
+}
@@ -0,0 +1,136 @@
+#include "FramePacer.hpp"
+
+#include <thread>
+
+namespace
+{
+	/// Consecutive missed frames before adaptive mode drops vertical synchronization
+	constexpr unsigned int frames_to_drop = 3;
+
+	/// Consecutive fast frames before adaptive mode synchronizes again
+	constexpr unsigned int frames_to_restore = 120;
+}
+
+FramePacer::FramePacer() :
+		_target_fps(0), _period(0), _deadline(0), _waited(0), _granularity(seconds_to_ticks(0.002)), _calibrated(false),
+		_vsync(VSync::On), _refresh_period(Ticks(1000000000) / 60), _vsync_enabled(true), _vsync_changed(false),
+		_missed(0), _kept(0)
+{
+}
+
+void FramePacer::set_target_fps(FramesPerSecond fps)
+{
+	_target_fps = fps;
+	_period = fps != 0 ? Ticks(1000000000) / fps : 0;
+	_deadline = 0;
+
+	if (fps != 0 && !_calibrated)
+		calibrate();
+}
+
+void FramePacer::set_vsync(VSync mode, FramesPerSecond refresh_rate)
+{
+	_vsync = mode;
+	_refresh_period = Ticks(1000000000) / std::max(refresh_rate, 1u);
+	_missed = _kept = 0;
+
+	bool enabled = mode != VSync::Off;
+	_vsync_changed |= enabled != _vsync_enabled;
+	_vsync_enabled = enabled;
+}
+
+void FramePacer::calibrate()
+{
+	Ticks worst = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		Ticks start = time_ticks();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		worst = std::max(worst, time_ticks() - start - seconds_to_ticks(0.001));
+	}
+
+	_granularity = std::max<Ticks>(worst, 0);
+	_calibrated = true;
+}
+
+bool FramePacer::record(Ticks frame_time)
+{
+	if (_vsync == VSync::Adaptive)
+	{
+		// What the frame took without our own wait; with vertical
+		// synchronization, a frame missing the refresh takes two periods
+		Ticks busy = frame_time - _waited;
+		Ticks period = std::max(_refresh_period, _period);
+
+		if (_vsync_enabled)
+		{
+			_missed = busy > period + period / 2 ? _missed + 1 : 0;
+			if (_missed >= frames_to_drop)
+			{
+				_vsync_enabled = false;
+				_vsync_changed = true;
+				_kept = 0;
+			}
+		}
+		else
+		{
+			_kept = busy < period - period / 5 ? _kept + 1 : 0;
+			if (_kept >= frames_to_restore)
+			{
+				_vsync_enabled = true;
+				_vsync_changed = true;
+				_missed = 0;
+			}
+		}
+	}
+
+	_waited = 0;
+
+	bool changed = _vsync_changed;
+	_vsync_changed = false;
+	return changed;
+}
+
+void FramePacer::wait()
+{
+	if (_period == 0)
+		return;
+
+	Ticks now = time_ticks();
+	_deadline += _period;
+
+	if (_deadline <= now)
+	{
+		// Late: start over from now rather than rushing the next frames
+		if (now - _deadline > _period)
+			_deadline = now;
+		return;
+	}
+
+	sleep_until(_deadline);
+	_waited = time_ticks() - now;
+}
+
+void FramePacer::sleep_until(Ticks deadline)
+{
+	for (;;)
+	{
+		Ticks now = time_ticks();
+		Ticks remaining = deadline - now;
+		if (remaining <= _granularity)
+			break;
+
+		Ticks requested = remaining - _granularity;
+		std::this_thread::sleep_for(std::chrono::nanoseconds(requested));
+
+		// Follow the actual granularity: jump up at once, decay slowly
+		Ticks overshoot = time_ticks() - now - requested;
+		if (overshoot > _granularity)
+			_granularity = overshoot;
+		else
+			_granularity -= (_granularity - std::max<Ticks>(overshoot, 0)) / 64;
+	}
+
+	while (time_ticks() < deadline)
+		std::this_thread::yield();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Time.hpp"
+
+/// How the pacer drives the vertical synchronization of the window
+enum class VSync
+{
+	/// Never synchronized; the frame limiter alone paces frames
+	Off,
+
+	/// Always synchronized
+	On,
+
+	/// Synchronized while frames keep up with the refresh rate, and
+	/// torn rather than halved to the next divisor of the refresh rate
+	/// when they do not
+	Adaptive
+};
+
+/// \brief Limits the frame rate and switches vertical synchronization
+///
+/// wait() sleeps until the end of the frame period, then spins for the
+/// last stretch: OS sleeps overshoot by up to their granularity, which is
+/// measured by calibrate() and refined by every sleep, so the pacer only
+/// sleeps while more than that remains.
+///
+/// Frame deadlines advance by whole periods, so a late frame does not
+/// delay the next ones; a frame later than a full period resets them.
+class FramePacer
+{
+public:
+	FramePacer();
+
+	/// Frames per second to limit to, 0 to not limit
+	void set_target_fps(FramesPerSecond fps);
+
+	inline FramesPerSecond target_fps() const
+	{ return _target_fps; }
+
+	/// \brief Selects the vertical synchronization mode
+	///
+	/// refresh_rate is the rate of the display, used by VSync::Adaptive to
+	/// tell missed frames.
+	void set_vsync(VSync mode, FramesPerSecond refresh_rate = 60);
+
+	inline VSync vsync() const
+	{ return _vsync; }
+
+	/// Whether the window should currently be synchronized
+	inline bool vsync_enabled() const
+	{ return _vsync_enabled; }
+
+	/// \brief Measures the granularity of OS sleeps
+	///
+	/// Takes a few milliseconds; done on the first set_target_fps().
+	void calibrate();
+
+	/// Longest expected overshoot of a sleep
+	inline Ticks sleep_granularity() const
+	{ return _granularity; }
+
+	/// \brief Records the duration of the last frame, waits included
+	///
+	/// Returns true when vsync_enabled() changed since the previous call,
+	/// and the window needs updating.
+	bool record(Ticks frame_time);
+
+	/// Waits for the end of the current frame period
+	void wait();
+
+private:
+	void sleep_until(Ticks deadline);
+
+	FramesPerSecond _target_fps;
+	Ticks _period;
+	Ticks _deadline;
+	Ticks _waited;
+	Ticks _granularity;
+	bool _calibrated;
+
+	VSync _vsync;
+	Ticks _refresh_period;
+	bool _vsync_enabled;
+	bool _vsync_changed;
+	unsigned int _missed;
+	unsigned int _kept;
+};
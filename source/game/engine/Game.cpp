@@ -1,17 +1,23 @@
 #include "Game.hpp"
 
+#include <cstdlib>
+#include <cstring>
+
 #include "imgui/sfml-rendering.h"
 #include "imgui/sfml-events.h"
 
 using namespace sf;
 
-Game::Game() : _error_state(0), _is_running(true)
+Game::Game() :
+		_null_target({960, 640}), _frame_ticks(0), _frame_delta(0), _frame_limit(0), _frame_count(0), _error_state(0),
+		_is_running(true), _headless(false), _show_profiler(false)
 {
 }
 
 Game::~Game()
 {
-	ImGui::SFML::Shutdown();
+	if (_window)
+		ImGui::SFML::Shutdown();
 }
 
 void Game::quit(int errorCode)
@@ -20,27 +26,68 @@ void Game::quit(int errorCode)
 
 	_error_state = errorCode;
 	_is_running = false;
-	_window.close();
+	if (_window)
+		_window->close();
+}
+
+void Game::set_update_rate(FramesPerSecond hz, unsigned int max_steps)
+{
+	_timestep.set_rate(hz, max_steps);
+}
+
+void Game::apply_vsync()
+{
+	if (_window)
+		_window->setVerticalSyncEnabled(_pacer.vsync_enabled());
 }
 
-void Game::init(int, char**)
+void Game::init(int argc, char** argv)
 {
-	_window.create({960, 640}, "ProjectRune - Game", Style::Titlebar | Style::Close);
-	_window.setVerticalSyncEnabled(true);
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--headless") == 0)
+			_headless = true;
+		else if (std::strncmp(argv[i], "--headless=", 11) == 0)
+		{
+			_headless = true;
+			_pacer.set_target_fps(FramesPerSecond(std::strtoul(argv[i] + 11, nullptr, 10)));
+		}
+		else if (std::strncmp(argv[i], "--frames=", 9) == 0)
+			_frame_limit = std::strtoul(argv[i] + 9, nullptr, 10);
+		else if (std::strcmp(argv[i], "--profile") == 0)
+			_show_profiler = true;
+	}
+
+	Profiler::set_thread_name("Main");
+	Profiler::set_enabled(_show_profiler);
+
+	if (_headless)
+	{
+		_pacer.set_vsync(VSync::Off);
+		return;
+	}
 
-	ImGui::SFML::SetRenderTarget(_window);
+	_window.reset(new RenderWindow({960, 640}, "ProjectRune - Game", Style::Titlebar | Style::Close));
+	apply_vsync();
+
+	ImGui::SFML::SetRenderTarget(*_window);
 	ImGui::SFML::InitImGuiRendering();
-	ImGui::SFML::SetWindow(_window);
+	ImGui::SFML::SetWindow(*_window);
 	ImGui::SFML::InitImGuiEvents();
 }
 
 void Game::frame_start()
 {
-	ImGui::SFML::UpdateImGui();
+	RUNE_PROFILE_ZONE("Game::frame_start");
+
+	if (!_window)
+		return;
+
+	ImGui::SFML::UpdateImGui(_frame_delta);
 	ImGui::SFML::UpdateImGuiRendering();
 
 	Event e;
-	while (_window.pollEvent(e))
+	while (_window->pollEvent(e))
 	{
 		ImGui::SFML::ProcessEvent(e);
 		process_event(e);
@@ -53,17 +100,44 @@ void Game::process_event(Event& e)
 		quit();
 	if (e.type == Event::Closed)
 		quit();
+	if (e.type == Event::KeyPressed && e.key.code == Keyboard::F3)
+	{
+		_show_profiler = !_show_profiler;
+		Profiler::set_enabled(_show_profiler);
+	}
 }
 
 void Game::update(Seconds)
 {
-	_window.clear(Color(32, 32, 32));
+}
+
+void Game::render(float)
+{
+	if (_window)
+		_window->clear(Color(32, 32, 32));
 }
 
 void Game::frame_end()
 {
-	ImGui::Render();
-	_window.display();
+	if (_window)
+	{
+		if (_show_profiler)
+		{
+			Profiler::draw(&_show_profiler);
+			if (!_show_profiler)
+				Profiler::set_enabled(false);
+		}
+
+		{
+			RUNE_PROFILE_ZONE("ImGui::Render");
+			ImGui::Render();
+		}
+
+		_window->display();
+	}
+
+	if (_frame_limit != 0 && ++_frame_count >= _frame_limit)
+		quit();
 }
 
 void GameStateStack::push(GameState* state, PushType pushType)
@@ -116,12 +190,14 @@ void GameStateStack::pop()
 
 void GameStateStack::update(Seconds delta_time)
 {
+	RUNE_PROFILE_ZONE("GameStateStack::update");
 	perform_f_on_stack([&](GameState* state) { state->update(delta_time); });
 }
 
-void GameStateStack::render()
+void GameStateStack::render(float alpha)
 {
-	perform_f_on_stack([](GameState* state) { state->render(); });
+	RUNE_PROFILE_ZONE("GameStateStack::render");
+	perform_f_on_stack([&](GameState* state) { state->render(alpha); });
 }
 
 void GameStateStack::clear()
@@ -3,13 +3,44 @@
 #include <type_traits>
 #include <functional>
 #include <utility>
+#include <memory>
 #include <vector>
 
 #include <SFML/Graphics.hpp>
 #include "imgui/imgui.h"
 
+#include "FramePacer.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
 #include "Time.hpp"
 
+/// \brief A render target drawing nothing, for headless games
+///
+/// Never activates, so draws and clears are dropped without touching GL.
+class NullRenderTarget : public sf::RenderTarget
+{
+public:
+	explicit NullRenderTarget(sf::Vector2u size) : _size(size)
+	{ }
+
+	virtual inline sf::Vector2u getSize() const override
+	{ return _size; }
+
+#if SFML_VERSION_MAJOR > 2 || (SFML_VERSION_MAJOR == 2 && SFML_VERSION_MINOR >= 5)
+	// SFML 2.5 replaced the private activate() with a public setActive()
+	virtual inline bool setActive(bool = true) override
+	{ return false; }
+
+private:
+#else
+private:
+	virtual inline bool activate(bool) override
+	{ return false; }
+#endif
+
+	sf::Vector2u _size;
+};
+
 struct Game
 {
 public:
@@ -31,11 +62,50 @@ public:
 	virtual inline bool is_running() const final
 	{ return _is_running; }
 
+	/// The window, or a NullRenderTarget when headless
 	virtual inline sf::RenderTarget& target() final
-	{ return _window; }
+	{ return _window ? static_cast<sf::RenderTarget&>(*_window) : _null_target; }
+
+	/// True when running without window nor GL context
+	virtual inline bool is_headless() const final
+	{ return _headless; }
+
+	virtual inline JobSystem& jobs() final
+	{ return _jobs; }
+
+	/// Frame limiter and vertical synchronization, applied by run()
+	virtual inline FramePacer& pacer() final
+	{ return _pacer; }
+
+	virtual inline FixedTimestep const& timestep() const final
+	{ return _timestep; }
+
+	/// Timestamp of the start of the current frame, see time_ticks()
+	virtual inline Ticks frame_ticks() const final
+	{ return _frame_ticks; }
+
+	/// Time elapsed between the starts of the previous and current frames
+	virtual inline Seconds frame_delta() const final
+	{ return _frame_delta; }
+
+	/// \brief Runs update() hz times per second, at most max_steps times per frame
+	///
+	/// A rate of 0, the default, runs update() once per frame with the
+	/// frame time.
+	virtual void set_update_rate(FramesPerSecond hz, unsigned int max_steps = 8) final;
 
 	virtual void quit(int errorCode = 0) final;
 
+	/// \brief Opens the window, or parses the headless options
+	///
+	/// Recognized arguments:
+	/// - `--headless`: no window, no GL nor ImGui; update() runs once per
+	///   frame as fast as possible, with the fixed step if any
+	/// - `--headless=<fps>`: the same, paced at fps frames per second
+	/// - `--frames=<count>`: quits after count frames
+	/// - `--profile`: records from the start, showing the profiler
+	///
+	/// F3 shows and hides the profiler.
 	virtual void init(int argc, char** argv);
 
 	virtual void frame_start();
@@ -44,12 +114,33 @@ public:
 
 	virtual void update(Seconds delta_time);
 
+	/// \brief Called once per frame, after the updates
+	///
+	/// alpha is the fraction of an update step elapsed since the last
+	/// update, to interpolate between the last two simulated states.
+	virtual void render(float alpha);
+
 	virtual void frame_end();
 
 private:
-	sf::RenderWindow _window;
+	template<class GameType>
+	friend int run(int argc, char** argv);
+
+	void apply_vsync();
+
+	std::unique_ptr<sf::RenderWindow> _window;
+	NullRenderTarget _null_target;
+	JobSystem _jobs;
+	FramePacer _pacer;
+	FixedTimestep _timestep;
+	Ticks _frame_ticks;
+	Seconds _frame_delta;
+	unsigned long _frame_limit;
+	unsigned long _frame_count;
 	int _error_state;
 	bool _is_running;
+	bool _headless;
+	bool _show_profiler;
 };
 
 class GameState
@@ -86,7 +177,7 @@ public:
 	virtual inline void update(Seconds)
 	{ }
 
-	virtual inline void render()
+	virtual inline void render(float)
 	{ }
 
 	virtual inline void on_pause()
@@ -186,7 +277,7 @@ public:
 
 	void update(Seconds delta_time);
 
-	void render();
+	void render(float alpha);
 
 	void clear();
 
@@ -234,22 +325,42 @@ private:
 };
 
 template<class GameType>
-static inline int run(int argc, char** argv)
+inline int run(int argc, char** argv)
 {
 	static_assert(std::is_base_of<Game, GameType>::value, "GameType must be a Game");
 	GameType app;
 	app.init(argc, argv);
 
-	Seconds last_time = time_now();
+	app._frame_ticks = time_ticks();
 	while (app.is_running())
 	{
-		Seconds current = time_now();
-		Seconds frame_time = current - last_time;
-		last_time = current;
+		Ticks current = time_ticks();
+		Ticks frame_time = current - app._frame_ticks;
+		app._frame_ticks = current;
+		app._frame_delta = time_between(0, frame_time);
+
+		if (Profiler::enabled())
+			Profiler::new_frame();
+
+		if (app._pacer.record(frame_time))
+			app.apply_vsync();
 
 		app.frame_start();
-		app.update(frame_time);
+
+		auto& timestep = app._timestep;
+		Seconds delta_time = timestep.enabled() ? timestep.step() : app._frame_delta;
+
+		// Unpaced headless games simulate one step per frame, faster than real time
+		bool unpaced = app._headless && app._pacer.target_fps() == 0;
+		for (unsigned int steps = unpaced ? 1 : timestep.advance(frame_time); steps > 0 && app.is_running(); --steps)
+			app.update(delta_time);
+
+		if (!app._headless)
+			app.render(timestep.alpha());
+
 		app.frame_end();
+
+		app._pacer.wait();
 	}
 
 	return app.error_state();
@@ -0,0 +1,139 @@
+#include "JobSystem.hpp"
+
+namespace
+{
+	thread_local JobSystem const* tls_system = nullptr;
+	thread_local size_t tls_index = 0;
+}
+
+JobSystem::JobSystem(size_t workers) : _queued(0), _running(true)
+{
+	for (size_t i = 0; i <= workers; ++i)
+		_queues.emplace_back(new Queue);
+
+	for (size_t i = 1; i <= workers; ++i)
+		_workers.emplace_back([this, i] { worker_main(i); });
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(_sleep_mutex);
+		_running = false;
+	}
+	_wake.notify_all();
+
+	for (auto& worker : _workers)
+		worker.join();
+}
+
+size_t JobSystem::default_worker_count()
+{
+	return std::max(std::thread::hardware_concurrency(), 1u) - 1;
+}
+
+size_t JobSystem::thread_index() const
+{
+	return tls_system == this ? tls_index : 0;
+}
+
+void JobSystem::submit(Batch& batch, size_t count, size_t grain)
+{
+	size_t jobs = (count + grain - 1) / grain;
+	batch.pending = jobs;
+
+	// count the jobs before publishing them, so a worker popping one
+	// right away never takes _queued below zero
+	{
+		std::lock_guard<std::mutex> lock(_sleep_mutex);
+		_queued += jobs;
+	}
+
+	// deal the ranges round-robin, starting with the submitting thread
+	size_t first = thread_index();
+	for (size_t q = 0; q < _queues.size() && q < jobs; ++q)
+	{
+		auto& queue = *_queues[(first + q) % _queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		for (size_t j = q; j < jobs; j += _queues.size())
+			queue.jobs.push_back({&batch, j * grain, std::min(count, (j + 1) * grain)});
+	}
+
+	_wake.notify_all();
+}
+
+void JobSystem::wait(Batch& batch)
+{
+	size_t index = thread_index();
+	Job job;
+
+	while (batch.pending > 0)
+	{
+		if (pop(index, job) || steal(index, job))
+			execute(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::pop(size_t index, Job& job)
+{
+	auto& queue = *_queues[index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+
+	if (queue.jobs.empty())
+		return false;
+
+	job = queue.jobs.back();
+	queue.jobs.pop_back();
+	--_queued;
+	return true;
+}
+
+bool JobSystem::steal(size_t index, Job& job)
+{
+	for (size_t i = 1; i < _queues.size(); ++i)
+	{
+		auto& queue = *_queues[(index + i) % _queues.size()];
+		std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+
+		if (!lock.owns_lock() || queue.jobs.empty())
+			continue;
+
+		job = queue.jobs.front();
+		queue.jobs.pop_front();
+		--_queued;
+		return true;
+	}
+
+	return false;
+}
+
+void JobSystem::execute(Job const& job)
+{
+	job.batch->run(job.batch->context, job.begin, job.end);
+	--job.batch->pending;
+}
+
+void JobSystem::worker_main(size_t index)
+{
+	tls_system = this;
+	tls_index = index;
+
+	Job job;
+	while (true)
+	{
+		if (pop(index, job) || steal(index, job))
+		{
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_sleep_mutex);
+		_wake.wait(lock, [this] { return !_running || _queued > 0; });
+
+		if (!_running)
+			return;
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+/// \brief A pool of worker threads with work stealing
+///
+/// Every thread taking part in jobs owns a queue. The thread that submits
+/// work spreads it over all queues and helps until it is done; each worker
+/// pops from the back of its own queue and steals from the front of the
+/// others when it runs dry.
+///
+/// Jobs must not throw.
+class JobSystem
+{
+public:
+	/// Creates the pool with the given number of worker threads,
+	/// on top of the thread submitting work
+	explicit JobSystem(size_t workers = default_worker_count());
+
+	~JobSystem();
+
+	JobSystem(JobSystem const& other) = delete;
+
+	JobSystem(JobSystem&& other) = delete;
+
+	JobSystem& operator=(JobSystem const& other) = delete;
+
+	JobSystem& operator=(JobSystem&& other) = delete;
+
+	/// One worker per hardware thread, minus the main thread
+	static size_t default_worker_count();
+
+	/// Number of threads taking part in jobs, including the submitting thread
+	inline size_t thread_count() const
+	{ return _queues.size(); }
+
+	/// Index of the calling thread, in [0, thread_count())
+	///
+	/// Threads outside of the pool share index 0.
+	size_t thread_index() const;
+
+	/// \brief Calls f(begin, end) over [0, count) split in ranges of about grain elements
+	///
+	/// Returns once every range was processed. f is shared by every thread.
+	template<typename F>
+	void parallel_for(size_t count, size_t grain, F&& f)
+	{
+		if (count == 0)
+			return;
+
+		grain = std::max<size_t>(grain, 1);
+		if (count <= grain || _workers.empty())
+		{
+			f(size_t(0), count);
+			return;
+		}
+
+		Batch batch;
+		batch.run = &invoke<std::remove_reference_t<F>>;
+		batch.context = const_cast<void*>(static_cast<void const*>(std::addressof(f)));
+
+		submit(batch, count, grain);
+		wait(batch);
+	}
+
+private:
+	struct Batch
+	{
+		void (*run)(void* context, size_t begin, size_t end);
+		void* context;
+		std::atomic<size_t> pending{0};
+	};
+
+	struct Job
+	{
+		Batch* batch;
+		size_t begin;
+		size_t end;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	template<typename F>
+	static void invoke(void* context, size_t begin, size_t end)
+	{
+		(*static_cast<F*>(context))(begin, end);
+	}
+
+	void submit(Batch& batch, size_t count, size_t grain);
+
+	void wait(Batch& batch);
+
+	bool pop(size_t index, Job& job);
+
+	bool steal(size_t index, Job& job);
+
+	void execute(Job const& job);
+
+	void worker_main(size_t index);
+
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::thread> _workers;
+
+	std::mutex _sleep_mutex;
+	std::condition_variable _wake;
+	std::atomic<size_t> _queued;
+	std::atomic<bool> _running;
+};
@@ -0,0 +1,311 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cfloat>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "imgui/imgui.h"
+#include "ginseng.hpp"
+
+std::atomic<bool> Profiler::_enabled(false);
+
+namespace
+{
+	/// Events per thread; a thread recording more between two frames loses the oldest
+	constexpr std::uint64_t buffer_size = 1 << 14;
+
+	/// Frame times kept for the graph
+	constexpr size_t history_size = 240;
+
+	/// A zone begin, or an end when name is null
+	struct Event
+	{
+		std::atomic<char const*> name;
+		std::atomic<Ticks> stamp;
+	};
+
+	struct Zone
+	{
+		char const* name;
+		Ticks start;
+		Ticks end;
+		size_t depth;
+		size_t thread;
+	};
+
+	/// \brief Events of one thread
+	///
+	/// Written by its thread only, which publishes them through head. The
+	/// other members belong to the reader, under the profiler mutex.
+	struct ThreadBuffer
+	{
+		std::atomic<std::uint64_t> head;
+		Event events[buffer_size];
+
+		std::string name;
+		std::uint64_t tail = 0;
+		std::vector<std::pair<char const*, Ticks>> open;
+	};
+
+	struct State
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+		/// Zones completed during the frame in progress
+		std::vector<Zone> pending;
+		Ticks frame_start = 0;
+
+		/// The frame shown by draw()
+		std::vector<Zone> shown;
+		Ticks shown_start = 0;
+		Ticks shown_end = 0;
+		bool paused = false;
+
+		std::vector<float> history = std::vector<float>(history_size, 0.f);
+		size_t history_pos = 0;
+	};
+
+	State& state()
+	{
+		static State s;
+		return s;
+	}
+
+	thread_local ThreadBuffer* tls_buffer = nullptr;
+
+	ThreadBuffer& thread_buffer()
+	{
+		if (!tls_buffer)
+		{
+			auto& s = state();
+			std::lock_guard<std::mutex> lock(s.mutex);
+
+			s.threads.emplace_back(new ThreadBuffer);
+			tls_buffer = s.threads.back().get();
+			tls_buffer->head.store(0, std::memory_order_relaxed);
+			tls_buffer->name = "Thread " + std::to_string(s.threads.size() - 1);
+		}
+
+		return *tls_buffer;
+	}
+
+	void record(char const* name)
+	{
+		auto& buffer = thread_buffer();
+		std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+
+		auto& event = buffer.events[head % buffer_size];
+		event.name.store(name, std::memory_order_relaxed);
+		event.stamp.store(time_ticks(), std::memory_order_relaxed);
+
+		buffer.head.store(head + 1, std::memory_order_release);
+	}
+
+	/// Turns the new events of a thread into zones; the profiler mutex must be held
+	void collect(ThreadBuffer& buffer, size_t thread, std::vector<Zone>& out)
+	{
+		std::uint64_t head = buffer.head.load(std::memory_order_acquire);
+
+		// The oldest events were overwritten: the nesting is lost
+		if (head - buffer.tail > buffer_size)
+		{
+			buffer.tail = head - buffer_size;
+			buffer.open.clear();
+		}
+
+		std::uint64_t first = buffer.tail;
+		size_t first_zone = out.size();
+
+		for (; buffer.tail != head; ++buffer.tail)
+		{
+			auto& event = buffer.events[buffer.tail % buffer_size];
+			char const* name = event.name.load(std::memory_order_relaxed);
+			Ticks stamp = event.stamp.load(std::memory_order_relaxed);
+
+			if (name)
+				buffer.open.emplace_back(name, stamp);
+			else if (!buffer.open.empty())
+			{
+				auto begin = buffer.open.back();
+				buffer.open.pop_back();
+				out.push_back({begin.first, begin.second, stamp, buffer.open.size(), thread});
+			}
+		}
+
+		// The thread lapped the reader meanwhile: what was read may be torn
+		if (buffer.head.load(std::memory_order_acquire) - first > buffer_size)
+		{
+			out.resize(first_zone);
+			buffer.open.clear();
+		}
+	}
+
+	ImU32 zone_color(char const* name)
+	{
+		// Same name, same color
+		auto hash = std::uint32_t(reinterpret_cast<std::uintptr_t>(name) * 2654435761u);
+		return ImColor::HSV(float(hash % 360) / 360.f, 0.5f, 0.75f);
+	}
+
+	void draw_timeline(State& s)
+	{
+		float const row = ImGui::GetTextLineHeightWithSpacing();
+		float const width = std::max(ImGui::GetContentRegionAvailWidth(), 1.f);
+		double const scale = width / double(std::max<Ticks>(s.shown_end - s.shown_start, 1));
+
+		auto draw_list = ImGui::GetWindowDrawList();
+
+		for (size_t t = 0; t < s.threads.size(); ++t)
+		{
+			size_t depth = 0;
+			bool any = false;
+			for (auto& zone : s.shown)
+			{
+				if (zone.thread == t)
+				{
+					depth = std::max(depth, zone.depth + 1);
+					any = true;
+				}
+			}
+
+			if (!any)
+				continue;
+
+			ImGui::TextUnformatted(s.threads[t]->name.c_str());
+
+			ImVec2 origin = ImGui::GetCursorScreenPos();
+			ImGui::Dummy(ImVec2(width, depth * row));
+
+			for (auto& zone : s.shown)
+			{
+				if (zone.thread != t)
+					continue;
+
+				ImVec2 min(origin.x + float((zone.start - s.shown_start) * scale), origin.y + zone.depth * row);
+				ImVec2 max(std::max(origin.x + float((zone.end - s.shown_start) * scale), min.x + 1.f), min.y + row - 1.f);
+
+				draw_list->AddRectFilled(min, max, zone_color(zone.name));
+
+				if (ImGui::CalcTextSize(zone.name).x + 4.f < max.x - min.x)
+					draw_list->AddText(ImVec2(min.x + 2.f, min.y), IM_COL32_BLACK, zone.name);
+
+				if (ImGui::IsMouseHoveringRect(min, max))
+					ImGui::SetTooltip("%s\n%.3f ms", zone.name, ticks_to_seconds(zone.end - zone.start) * 1000.0);
+			}
+		}
+	}
+}
+
+void Profiler::set_enabled(bool enabled)
+{
+	auto& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+
+	if (enabled == _enabled.load(std::memory_order_relaxed))
+		return;
+
+	auto& hooks = ginseng::profile_hooks();
+	if (enabled)
+	{
+		// Start over: events from before were only ends of zones
+		for (auto& buffer : s.threads)
+		{
+			buffer->tail = buffer->head.load(std::memory_order_acquire);
+			buffer->open.clear();
+		}
+
+		s.pending.clear();
+		s.frame_start = 0;
+
+		hooks.end.store(&Profiler::end, std::memory_order_relaxed);
+		hooks.begin.store(&Profiler::begin, std::memory_order_release);
+	}
+	else
+	{
+		hooks.begin.store(nullptr, std::memory_order_release);
+	}
+
+	_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::set_thread_name(char const* name)
+{
+	auto& buffer = thread_buffer();
+	auto& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	buffer.name = name;
+}
+
+void Profiler::begin(char const* name)
+{
+	record(name);
+}
+
+void Profiler::end()
+{
+	record(nullptr);
+}
+
+void Profiler::new_frame()
+{
+	auto& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	Ticks now = time_ticks();
+
+	for (size_t t = 0; t < s.threads.size(); ++t)
+		collect(*s.threads[t], t, s.pending);
+
+	if (s.frame_start != 0)
+	{
+		if (!s.paused)
+		{
+			s.shown.clear();
+			for (auto& zone : s.pending)
+				if (zone.start >= s.frame_start && zone.start < now)
+					s.shown.push_back(zone);
+
+			s.shown_start = s.frame_start;
+			s.shown_end = now;
+		}
+
+		s.history[s.history_pos] = float(ticks_to_seconds(now - s.frame_start) * 1000.0);
+		s.history_pos = (s.history_pos + 1) % history_size;
+	}
+
+	// Zones of other threads may already belong to the next frame
+	s.pending.erase(std::remove_if(s.pending.begin(), s.pending.end(), [&](Zone const& zone) { return zone.start < now; }), s.pending.end());
+	s.frame_start = now;
+}
+
+void Profiler::draw(bool* open)
+{
+	if (!ImGui::Begin("Profiler", open))
+	{
+		ImGui::End();
+		return;
+	}
+
+	bool recording = enabled();
+	if (ImGui::Checkbox("Record", &recording))
+		set_enabled(recording);
+
+	auto& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+
+	ImGui::SameLine();
+	ImGui::Checkbox("Pause", &s.paused);
+
+	char overlay[32];
+	std::snprintf(overlay, sizeof(overlay), "%.3f ms", ticks_to_seconds(s.shown_end - s.shown_start) * 1000.0);
+	ImGui::PlotLines("##frames", s.history.data(), int(history_size), int(s.history_pos), overlay, 0.f, FLT_MAX, ImVec2(ImGui::GetContentRegionAvailWidth(), 48.f));
+
+	draw_timeline(s);
+
+	ImGui::End();
+}
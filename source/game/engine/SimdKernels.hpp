@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define RUNE_SIMD_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RUNE_SIMD_SSE
+#endif
+
+#include "ginseng.hpp"
+#include "Time.hpp"
+
+/// \brief Movement kernels over flat float arrays
+///
+/// Each kernel processes n floats, 8 at a time with AVX, 4 at a time with
+/// SSE, and the remainder one by one. They are meant for the arrays handed
+/// out by ginseng's visit_batch(), where n components of two floats are
+/// 2 * n floats. Arrays do not need to be aligned.
+namespace simd
+{
+	/// dst[i] += src[i] * factor
+	inline void multiply_add(float* dst, float const* src, float factor, size_t n)
+	{
+		size_t i = 0;
+
+#if defined(RUNE_SIMD_AVX)
+		__m256 f8 = _mm256_set1_ps(factor);
+		for (; i + 8 <= n; i += 8)
+			_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), f8)));
+#endif
+
+#if defined(RUNE_SIMD_AVX) || defined(RUNE_SIMD_SSE)
+		__m128 f4 = _mm_set1_ps(factor);
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), f4)));
+#endif
+
+		for (; i < n; ++i)
+			dst[i] += src[i] * factor;
+	}
+
+	/// dst[i] *= factor
+	inline void scale(float* dst, float factor, size_t n)
+	{
+		size_t i = 0;
+
+#if defined(RUNE_SIMD_AVX)
+		__m256 f8 = _mm256_set1_ps(factor);
+		for (; i + 8 <= n; i += 8)
+			_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), f8));
+#endif
+
+#if defined(RUNE_SIMD_AVX) || defined(RUNE_SIMD_SSE)
+		__m128 f4 = _mm_set1_ps(factor);
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), f4));
+#endif
+
+		for (; i < n; ++i)
+			dst[i] *= factor;
+	}
+
+	/// \brief Semi-implicit Euler step: vel += acc * dt, then pos += vel * dt
+	///
+	/// Fused in one pass, so velocities are read once.
+	inline void integrate(float* pos, float* vel, float const* acc, float dt, size_t n)
+	{
+		size_t i = 0;
+
+#if defined(RUNE_SIMD_AVX)
+		__m256 dt8 = _mm256_set1_ps(dt);
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256 v = _mm256_add_ps(_mm256_loadu_ps(vel + i), _mm256_mul_ps(_mm256_loadu_ps(acc + i), dt8));
+			_mm256_storeu_ps(vel + i, v);
+			_mm256_storeu_ps(pos + i, _mm256_add_ps(_mm256_loadu_ps(pos + i), _mm256_mul_ps(v, dt8)));
+		}
+#endif
+
+#if defined(RUNE_SIMD_AVX) || defined(RUNE_SIMD_SSE)
+		__m128 dt4 = _mm_set1_ps(dt);
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 v = _mm_add_ps(_mm_loadu_ps(vel + i), _mm_mul_ps(_mm_loadu_ps(acc + i), dt4));
+			_mm_storeu_ps(vel + i, v);
+			_mm_storeu_ps(pos + i, _mm_add_ps(_mm_loadu_ps(pos + i), _mm_mul_ps(v, dt4)));
+		}
+#endif
+
+		for (; i < n; ++i)
+		{
+			vel[i] += acc[i] * dt;
+			pos[i] += vel[i] * dt;
+		}
+	}
+
+	/// \brief Moves every Entity having a PositionT and a VelocityT
+	///
+	/// position += velocity * dt. Both components need the same Lanes.
+	template<typename PositionT, typename VelocityT, typename DB>
+	void move(DB& db, Seconds dt)
+	{
+		static_assert(ginseng::Lanes<PositionT>::count == ginseng::Lanes<VelocityT>::count, "Positions and velocities need the same lanes");
+
+		db.template visit_batch<PositionT, VelocityT const>([dt](float* pos, float const* vel, size_t n)
+		{
+			multiply_add(pos, vel, dt, n * ginseng::Lanes<PositionT>::count);
+		});
+	}
+
+	/// \brief Accelerates then moves every Entity having a PositionT, a VelocityT and an AccelerationT
+	///
+	/// Semi-implicit Euler, see integrate(). The three components need the
+	/// same Lanes.
+	template<typename PositionT, typename VelocityT, typename AccelerationT, typename DB>
+	void integrate(DB& db, Seconds dt)
+	{
+		static_assert(ginseng::Lanes<PositionT>::count == ginseng::Lanes<VelocityT>::count &&
+		              ginseng::Lanes<VelocityT>::count == ginseng::Lanes<AccelerationT>::count,
+		              "Positions, velocities and accelerations need the same lanes");
+
+		db.template visit_batch<PositionT, VelocityT, AccelerationT const>([dt](float* pos, float* vel, float const* acc, size_t n)
+		{
+			integrate(pos, vel, acc, dt, n * ginseng::Lanes<PositionT>::count);
+		});
+	}
+
+	/// \brief Multiplies every VelocityT by factor, such as a drag coefficient
+	template<typename VelocityT, typename DB>
+	void damp(DB& db, float factor)
+	{
+		db.template visit_batch<VelocityT>([factor](float* vel, size_t n)
+		{
+			scale(vel, factor, n * ginseng::Lanes<VelocityT>::count);
+		});
+	}
+}
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <cmath>
+
+#include <SFML/System/Vector2.hpp>
+#include <SFML/Graphics/Rect.hpp>
+
+#include "ginseng.hpp"
+
+/// Reads the `position` member of a position component
+struct MemberPosition
+{
+	template<typename PositionT>
+	inline sf::Vector2f operator()(PositionT const& p) const
+	{ return p.position; }
+};
+
+/// \brief A uniform grid over the entities of a ginseng::Database having a position component
+///
+/// Entities are bucketed by the cell containing their position. Each
+/// update() only visits the position components changed since the previous
+/// one, and only entities that left their cell are moved between buckets.
+/// Positions are copied in the grid, so queries read contiguous memory and
+/// never touch the database.
+///
+/// Entities erased from the database are dropped on the next update(),
+/// which only looks for them when the database version() changed.
+/// Entities losing their position component must be removed with remove().
+///
+/// The cell size should be about the size of the typical query.
+template<typename DB, typename PositionT, typename GetPosition = MemberPosition>
+class SpatialGrid
+{
+public:
+	using EntID = typename DB::EntID;
+
+	explicit SpatialGrid(float cell_size, GetPosition get_position = GetPosition()) :
+			_cell_size(cell_size), _inv_cell_size(1.f / cell_size), _get_position(get_position)
+	{ }
+
+	/// Number of entities in the grid
+	inline size_t size() const
+	{ return _entries.size(); }
+
+	/// \brief Brings the grid up to date with the database
+	///
+	/// Inserts the entities that gained a position and re-buckets the ones
+	/// that moved to another cell since the last update.
+	void update(DB& db)
+	{
+		db.visit([this](EntID eid, PositionT const& p, ginseng::Changed<PositionT>)
+		         {
+			         place(eid, _get_position(p));
+		         }, _tick);
+		_tick = db.tick();
+
+		// Nothing was erased while the structure stayed the same
+		if (db.version() != _version)
+		{
+			for (size_t i = _entries.size(); i-- > 0;)
+				if (!db.valid(_entries[i].eid))
+					erase_entry(uint32_t(i));
+
+			_version = db.version();
+		}
+	}
+
+	/// Removes an entity from the grid
+	void remove(EntID eid)
+	{
+		if (eid.index() < _entry_of.size() && _entry_of[eid.index()] != npos && _entries[_entry_of[eid.index()]].eid == eid)
+			erase_entry(_entry_of[eid.index()]);
+	}
+
+	/// Removes every entity
+	void clear()
+	{
+		_cells.clear();
+		_entries.clear();
+		_entry_of.clear();
+		_tick = 0;
+		_version = 0;
+	}
+
+	/// \brief Appends the entities inside a rectangle to out
+	void query_aabb(sf::FloatRect const& rect, std::vector<EntID>& out) const
+	{
+		for_cells(rect.left, rect.top, rect.left + rect.width, rect.top + rect.height, [&](std::vector<uint32_t> const& cell)
+		{
+			for (auto i : cell)
+			{
+				auto& entry = _entries[i];
+				if (entry.pos.x >= rect.left && entry.pos.x <= rect.left + rect.width &&
+				    entry.pos.y >= rect.top && entry.pos.y <= rect.top + rect.height)
+					out.push_back(entry.eid);
+			}
+		});
+	}
+
+	/// \brief Appends the entities within radius of center to out
+	void query_radius(sf::Vector2f center, float radius, std::vector<EntID>& out) const
+	{
+		float radius2 = radius * radius;
+
+		for_cells(center.x - radius, center.y - radius, center.x + radius, center.y + radius, [&](std::vector<uint32_t> const& cell)
+		{
+			for (auto i : cell)
+			{
+				auto& entry = _entries[i];
+				if (distance2(entry.pos, center) <= radius2)
+					out.push_back(entry.eid);
+			}
+		});
+	}
+
+	/// \brief Appends the k entities closest to center to out, closest first
+	///
+	/// Cells are searched in rings of growing size around center, until no
+	/// unvisited cell can hold a closer entity. Once a ring would cover more
+	/// cells than are occupied, every entity is scanned instead.
+	void nearest(sf::Vector2f center, size_t k, std::vector<EntID>& out) const
+	{
+		if (k == 0 || _entries.empty())
+			return;
+
+		std::vector<Candidate> best;
+		best.reserve(k);
+
+		auto closer = [](Candidate const& a, Candidate const& b) { return a.first < b.first; };
+
+		auto consider = [&](Entry const& entry)
+		{
+			float d = distance2(entry.pos, center);
+
+			if (best.size() < k)
+			{
+				best.emplace_back(d, entry.eid);
+				std::push_heap(best.begin(), best.end(), closer);
+			}
+			else if (d < best.front().first)
+			{
+				std::pop_heap(best.begin(), best.end(), closer);
+				best.back() = Candidate(d, entry.eid);
+				std::push_heap(best.begin(), best.end(), closer);
+			}
+		};
+
+		int32_t cx = cell_coord(center.x);
+		int32_t cy = cell_coord(center.y);
+
+		for (int32_t ring = 0;; ++ring)
+		{
+			// Far from the occupied cells, rings are mostly empty
+			uint64_t side = 2 * uint64_t(ring) + 1;
+			if (side * side > _cells.size())
+			{
+				best.clear();
+				for (auto& entry : _entries)
+					consider(entry);
+				break;
+			}
+
+			for (int32_t y = cy - ring; y <= cy + ring; ++y)
+			{
+				// Only the border of the ring is new
+				int32_t step = (y == cy - ring || y == cy + ring) ? 1 : std::max(2 * ring, 1);
+
+				for (int32_t x = cx - ring; x <= cx + ring; x += step)
+				{
+					auto cell = _cells.find(cell_key(x, y));
+					if (cell == _cells.end())
+						continue;
+
+					for (auto i : cell->second)
+						consider(_entries[i]);
+				}
+			}
+
+			// Cells of the next rings are at least this far from center
+			float reach = ring * _cell_size;
+			if (best.size() == k && best.front().first <= reach * reach)
+				break;
+		}
+
+		std::sort_heap(best.begin(), best.end(), closer);
+		for (auto& candidate : best)
+			out.push_back(candidate.second);
+	}
+
+private:
+	static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+	using Candidate = std::pair<float, EntID>;
+
+	struct Entry
+	{
+		EntID eid;
+		sf::Vector2f pos;
+		uint64_t cell;
+
+		/// Position of this entry in its cell
+		uint32_t slot;
+	};
+
+	static inline float distance2(sf::Vector2f a, sf::Vector2f b)
+	{
+		sf::Vector2f d = a - b;
+		return d.x * d.x + d.y * d.y;
+	}
+
+	inline int32_t cell_coord(float v) const
+	{ return int32_t(std::floor(v * _inv_cell_size)); }
+
+	static inline uint64_t cell_key(int32_t x, int32_t y)
+	{ return uint64_t(uint32_t(x)) << 32 | uint32_t(y); }
+
+	template<typename F>
+	void for_cells(float left, float top, float right, float bottom, F&& f) const
+	{
+		int32_t x0 = cell_coord(left), x1 = cell_coord(right);
+		int32_t y0 = cell_coord(top), y1 = cell_coord(bottom);
+
+		// Large areas are cheaper to test cell by cell from the occupied cells
+		if (uint64_t(x1 - x0 + 1) * uint64_t(y1 - y0 + 1) > _cells.size())
+		{
+			for (auto& cell : _cells)
+			{
+				int32_t x = int32_t(cell.first >> 32), y = int32_t(uint32_t(cell.first));
+				if (x >= x0 && x <= x1 && y >= y0 && y <= y1)
+					f(cell.second);
+			}
+			return;
+		}
+
+		for (int32_t y = y0; y <= y1; ++y)
+		{
+			for (int32_t x = x0; x <= x1; ++x)
+			{
+				auto cell = _cells.find(cell_key(x, y));
+				if (cell != _cells.end())
+					f(cell->second);
+			}
+		}
+	}
+
+	void place(EntID eid, sf::Vector2f pos)
+	{
+		uint64_t key = cell_key(cell_coord(pos.x), cell_coord(pos.y));
+
+		if (eid.index() >= _entry_of.size())
+			_entry_of.resize(eid.index() + 1, npos);
+
+		uint32_t i = _entry_of[eid.index()];
+		if (i != npos && _entries[i].eid != eid)
+		{
+			// The slot was reused by a new entity
+			erase_entry(i);
+			i = npos;
+		}
+
+		if (i == npos)
+		{
+			i = uint32_t(_entries.size());
+			_entries.push_back({eid, pos, key, 0});
+			_entry_of[eid.index()] = i;
+			link(i, key);
+			return;
+		}
+
+		auto& entry = _entries[i];
+		entry.pos = pos;
+
+		if (entry.cell != key)
+		{
+			unlink(i);
+			link(i, key);
+		}
+	}
+
+	void link(uint32_t i, uint64_t key)
+	{
+		auto cell = _cells.find(key);
+		if (cell == _cells.end())
+			cell = _cells.emplace(key, std::vector<uint32_t>()).first;
+
+		_entries[i].cell = key;
+		_entries[i].slot = uint32_t(cell->second.size());
+		cell->second.push_back(i);
+	}
+
+	/// Removes an entry from its cell, and the cell once empty, so only occupied cells are kept
+	void unlink(uint32_t i)
+	{
+		auto& entry = _entries[i];
+		auto cell = _cells.find(entry.cell);
+
+		uint32_t last = cell->second.back();
+		cell->second[entry.slot] = last;
+		_entries[last].slot = entry.slot;
+		cell->second.pop_back();
+
+		if (cell->second.empty())
+			_cells.erase(cell);
+	}
+
+	void erase_entry(uint32_t i)
+	{
+		unlink(i);
+		_entry_of[_entries[i].eid.index()] = npos;
+
+		uint32_t last = uint32_t(_entries.size() - 1);
+		if (i != last)
+		{
+			auto& moved = _entries[last];
+			_cells.find(moved.cell)->second[moved.slot] = i;
+			_entry_of[moved.eid.index()] = i;
+			_entries[i] = moved;
+		}
+
+		_entries.pop_back();
+	}
+
+	float _cell_size;
+	float _inv_cell_size;
+	GetPosition _get_position;
+
+	std::unordered_map<uint64_t, std::vector<uint32_t>> _cells;
+	std::vector<Entry> _entries;
+	std::vector<uint32_t> _entry_of;
+	uint64_t _tick = 0;
+	uint64_t _version = 0;
+};
+
+template<typename DB, typename PositionT, typename GetPosition>
+constexpr uint32_t SpatialGrid<DB, PositionT, GetPosition>::npos;
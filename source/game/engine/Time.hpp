@@ -1,12 +1,107 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <chrono>
 
 typedef unsigned int FramesPerSecond;
+
+/// Durations, such as frame times; only meaningful as differences
 typedef float Seconds;
 
-inline Seconds time_now()
+/// Timestamps and exact durations, in nanoseconds
+typedef std::int64_t Ticks;
+
+/// \brief Monotonic time since the start of the process
+///
+/// Based on steady_clock, which never jumps with the wall clock. Counts from
+/// the first call, made by run() at startup, so that values stay small:
+/// converted to seconds they keep their precision, unlike seconds since the
+/// clock epoch.
+inline Ticks time_ticks()
 {
 	using namespace std;
-	return chrono::duration_cast<chrono::duration<Seconds, ratio<1>>>(chrono::high_resolution_clock::now().time_since_epoch()).count();
+	static auto const start = chrono::steady_clock::now();
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
 }
+
+inline double ticks_to_seconds(Ticks ticks)
+{ return double(ticks) * 1e-9; }
+
+inline Ticks seconds_to_ticks(double seconds)
+{ return Ticks(seconds * 1e9); }
+
+/// Seconds elapsed between two timestamps
+inline Seconds time_between(Ticks from, Ticks to)
+{ return Seconds(ticks_to_seconds(to - from)); }
+
+/// Monotonic seconds since the start of the process
+inline double time_now()
+{ return ticks_to_seconds(time_ticks()); }
+
+/// \brief Turns variable frame times into fixed simulation steps
+///
+/// Frame times accumulate, and every whole step in the accumulator is one
+/// update. Past max_steps updates in one frame, the remaining whole steps
+/// are dropped: after a hitch the simulation falls behind instead of
+/// making the next frames longer still.
+class FixedTimestep
+{
+public:
+	/// A rate of 0 disables fixed steps
+	explicit FixedTimestep(FramesPerSecond rate = 0, unsigned int max_steps = 8)
+	{ set_rate(rate, max_steps); }
+
+	/// Changes the rate, dropping the accumulated time
+	inline void set_rate(FramesPerSecond rate, unsigned int max_steps = 8)
+	{
+		_rate = rate;
+		_step = rate != 0 ? Ticks(1000000000) / rate : 0;
+		_max_steps = std::max(max_steps, 1u);
+		_accumulator = 0;
+	}
+
+	inline bool enabled() const
+	{ return _rate != 0; }
+
+	inline FramesPerSecond rate() const
+	{ return _rate; }
+
+	/// Duration of one step
+	inline Seconds step() const
+	{ return Seconds(ticks_to_seconds(_step)); }
+
+	/// Adds the time of a frame, returning the number of steps to run
+	inline unsigned int advance(Ticks frame_time)
+	{
+		if (!enabled())
+			return 1;
+
+		_accumulator += frame_time;
+
+		unsigned int steps = 0;
+		while (_accumulator >= _step && steps < _max_steps)
+		{
+			_accumulator -= _step;
+			++steps;
+		}
+
+		if (_accumulator >= _step)
+			_accumulator %= _step;
+
+		return steps;
+	}
+
+	/// \brief Fraction of a step accumulated but not simulated yet, in [0, 1)
+	///
+	/// Rendering interpolates between the last two simulated states with it.
+	/// Always 1 when fixed steps are disabled.
+	inline float alpha() const
+	{ return enabled() ? float(double(_accumulator) / double(_step)) : 1.f; }
+
+private:
+	FramesPerSecond _rate;
+	Ticks _step;
+	unsigned int _max_steps;
+	Ticks _accumulator;
+};
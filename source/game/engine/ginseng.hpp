@@ -25,44 +25,746 @@
 
 #include <type_traits>
 #include <algorithm>
+#include <atomic>
+#include <array>
+#include <functional>
 #include <iterator>
 #include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <tuple>
-#include <list>
+
+#include "ctti/type_id.hpp"
 
 namespace ginseng
 {
+	/*! Relocation trait.
+	 *
+	 * True if a T can be moved to another address with a memcpy, leaving
+	 * the source as raw memory. Storages keeping components in raw memory
+	 * move such components without calling their move constructor and
+	 * destructor.
+	 *
+	 * True for trivially copyable types. Specialize it as true_type for
+	 * other types that do not point into themselves, such as types owning
+	 * a unique_ptr.
+	 */
+	template<typename T>
+	struct Relocatable : std::is_trivially_copyable<T>
+	{ };
+
+	/*! Lane trait.
+	 *
+	 * Describes a component made of count scalars of one type and nothing
+	 * else, such as `struct Velocity { float x, y; }`. Batch visitors see a
+	 * column of n such components as a flat array of n * count scalars,
+	 * which SIMD kernels process several lanes at a time.
+	 *
+	 * Not specialized by default. Specialize it through LanesOf:
+	 *
+	 *     namespace ginseng
+	 *     {
+	 *         template<>
+	 *         struct Lanes<Velocity> : LanesOf<float, 2>
+	 *         { };
+	 *     }
+	 */
+	template<typename T>
+	struct Lanes
+	{
+		using type = unsigned char;
+		static constexpr std::size_t count = 0;
+	};
+
+	/// Base of Lanes specializations.
+	template<typename Scalar, std::size_t Count>
+	struct LanesOf
+	{
+		using type = Scalar;
+		static constexpr std::size_t count = Count;
+	};
+
+	/*! Profiling hooks.
+	 *
+	 * When begin is set, visits call it with a static name as they start,
+	 * and end as they return, on the visiting thread. Unset by default, so
+	 * a visit only pays for one test. Set end before begin.
+	 */
+	struct ProfileHooks
+	{
+		std::atomic<void (*)(char const* name)> begin;
+		std::atomic<void (*)()> end;
+	};
+
+	/// The profiling hooks.
+	inline ProfileHooks& profile_hooks()
+	{
+		static ProfileHooks hooks = {{nullptr}, {nullptr}};
+		return hooks;
+	}
+
 	namespace _detail
 	{
 		using namespace std;
 
+		/// Reports the enclosing scope to the profiling hooks, if set.
+		class ProfileScope
+		{
+			void (*end)() = nullptr;
+
+		public:
+			explicit ProfileScope(char const* name)
+			{
+				auto& hooks = profile_hooks();
+				if (auto begin = hooks.begin.load(memory_order_acquire))
+				{
+					end = hooks.end.load(memory_order_relaxed);
+					begin(name);
+				}
+			}
+
+			~ProfileScope()
+			{
+				if (end)
+					end();
+			}
+
+			ProfileScope(ProfileScope const&) = delete;
+
+			ProfileScope& operator=(ProfileScope const&) = delete;
+		};
+
 		// GUID
 
-		using GUID = int_fast64_t;
+		/*! Component type ID.
+		 *
+		 * FNV-1a hash of the type name, computed at compile time by ctti.
+		 * Stable across runs and binaries, so it can be serialized.
+		 */
+		using GUID = uint64_t;
+
+		template<typename T>
+		struct GUIDOf
+		{
+			static constexpr GUID value = ctti::unnamed_type_id<T>().hash();
+		};
+
+		template<typename T>
+		constexpr GUID GUIDOf<T>::value;
+
+		template<typename T>
+		constexpr GUID getGUID()
+		{
+			return GUIDOf<T>::value;
+		}
+
+		// TypeList
+		template<typename... Ts>
+		struct TypeList
+		{ };
+
+		// TypeInfo
+
+		/*! Type-erased description of a component type.
+		 *
+		 * Used by storages that keep components of the same type packed in raw
+		 * memory, instead of behind individual allocations.
+		 */
+		struct TypeInfo
+		{
+			GUID guid;
+			size_t size;
+			size_t align;
+
+			/// True if relocate() can be replaced by a memcpy. See Relocatable.
+			bool relocatable;
+
+			/// Move-constructs the object at dst from src, then destroys src.
+			void (*relocate)(void* dst, void* src);
+
+			/// Destroys the object at ptr.
+			void (*destroy)(void* ptr);
+
+			/// Copy-constructs the object at dst from src.
+			/// Null if the type is not copy constructible.
+			void (*copy)(void* dst, void const* src);
+		};
+
+		template<typename T>
+		void relocateComponent(void* dst, void* src)
+		{
+			T* from = static_cast<T*>(src);
+			::new(dst) T(move(*from));
+			from->~T();
+		}
+
+		template<typename T>
+		void destroyComponent(void* ptr)
+		{
+			static_cast<T*>(ptr)->~T();
+		}
 
-		inline GUID& instGUID()
+		template<typename T>
+		void copyComponent(void* dst, void const* src)
 		{
-			static GUID guid = 0;
-			return guid;
+			::new(dst) T(*static_cast<T const*>(src));
 		}
 
-		inline GUID nextGUID()
+		template<typename T>
+		auto copyFunction(true_type) -> void (*)(void*, void const*)
 		{
-			GUID rv = ++instGUID();
-			if (rv == numeric_limits<GUID>::max())
-				throw;
-			return rv;
+			return &copyComponent<T>;
 		}
 
 		template<typename T>
-		GUID getGUID()
+		auto copyFunction(false_type) -> void (*)(void*, void const*)
+		{
+			return nullptr;
+		}
+
+		template<typename T>
+		struct TypeInfoOf
+		{
+			static TypeInfo const* get()
+			{
+				static TypeInfo const info = {getGUID<T>(), sizeof(T), alignof(T), Relocatable<T>::value, &relocateComponent<T>, &destroyComponent<T>, copyFunction<T>(is_copy_constructible<T>{})};
+				return &info;
+			}
+		};
+
+		template<typename T>
+		TypeInfo const* getTypeInfo()
 		{
-			static GUID guid = nextGUID();
-			return guid;
+			return TypeInfoOf<T>::get();
 		}
 
+		/// Relocates a component, with a memcpy if its type is relocatable.
+		inline void relocateValue(TypeInfo const* info, void* dst, void* src)
+		{
+			if (info->relocatable)
+				memcpy(dst, src, info->size);
+			else
+				info->relocate(dst, src);
+		}
+
+		/*! Pending component
+		 *
+		 * A type-erased component value waiting to be relocated into a
+		 * Database. Tags have no value.
+		 */
+		struct PendingComponent
+		{
+			TypeInfo const* info;
+			void* value;
+		};
+
+		// EntID
+
+		/*! Entity ID
+		 *
+		 * A handle to an Entity: a slot index and the generation of the slot
+		 * when the Entity was created. Erasing an Entity bumps the generation
+		 * of its slot, so dangling handles are detected with one compare.
+		 *
+		 * Trivially copyable and 64 bits wide, so it can be hashed, serialized
+		 * with value(), and sent across threads or to Lua as is.
+		 * A default-constructed EntID never refers to an Entity.
+		 */
+		class EntID
+		{
+			uint32_t _index = numeric_limits<uint32_t>::max();
+			uint32_t _generation = 0;
+
+		public:
+			EntID() = default;
+
+			EntID(uint32_t index, uint32_t generation) : _index(index), _generation(generation)
+			{ }
+
+			/// Slot index of the Entity.
+			uint32_t index() const
+			{
+				return _index;
+			}
+
+			/// Generation of the slot when the Entity was created.
+			uint32_t generation() const
+			{
+				return _generation;
+			}
+
+			/// Packs this EntID in a single integer.
+			uint64_t value() const
+			{
+				return uint64_t(_generation) << 32 | _index;
+			}
+
+			/// Unpacks an EntID packed with value().
+			static EntID from_value(uint64_t value)
+			{
+				return {uint32_t(value), uint32_t(value >> 32)};
+			}
+
+			/*! Compares this EntID to another for equivalence.
+			 *
+			 * Returns true only if the two EntIDs are handles to the same
+			 * Entity.
+			 *
+			 * @param other The EntID to compare to this.
+			 * @return True if EntIDs are equivalent.
+			 */
+			bool operator==(EntID const& other) const
+			{
+				return value() == other.value();
+			}
+
+			bool operator!=(EntID const& other) const
+			{
+				return value() != other.value();
+			}
+
+			/*! Compares this EntID to another for ordering.
+			 *
+			 * Provides a strict weak ordering for EntIDs, by slot index first.
+			 *
+			 * @param other The EntID to compare to this.
+			 * @return True if this should be ordered before other.
+			 */
+			bool operator<(EntID const& other) const
+			{
+				return _index < other._index || (_index == other._index && _generation < other._generation);
+			}
+		};
+
+		static_assert(sizeof(EntID) == 8 && is_trivially_copyable<EntID>::value, "EntID must be a plain 64-bit value");
+
+		// SlotTable
+
+		/*! Slot table
+		 *
+		 * Stores one value per Entity, indexed by the Entity's slot index.
+		 * Indices of erased Entities are recycled through a free list.
+		 *
+		 * @tparam T Per-Entity value.
+		 * @tparam AllocatorT Allocator for the slots.
+		 */
+		template<typename T, template<typename> class AllocatorT>
+		class SlotTable
+		{
+			struct Slot
+			{
+				T value;
+				uint32_t generation;
+				bool alive;
+			};
+
+			vector<Slot, AllocatorT<Slot>> slots;
+			vector<uint32_t, AllocatorT<uint32_t>> free_indices;
+			size_t count = 0;
+
+		public:
+			/// Creates an Entity with the given value.
+			template<typename... Args>
+			EntID emplace(Args&& ... args)
+			{
+				uint32_t index;
+
+				if (free_indices.empty())
+				{
+					index = uint32_t(slots.size());
+					slots.push_back({T(std::forward<Args>(args)...), 1, true});
+				}
+				else
+				{
+					index = free_indices.back();
+					free_indices.pop_back();
+
+					auto& slot = slots[index];
+					slot.value = T(std::forward<Args>(args)...);
+					slot.alive = true;
+				}
+
+				++count;
+				return {index, slots[index].generation};
+			}
+
+			/// Makes room for n more Entities.
+			void reserve(size_t n)
+			{
+				if (n > free_indices.size())
+					slots.reserve(slots.size() + n - free_indices.size());
+			}
+
+			/// Erases an Entity, resetting its value. Does nothing for a dangling EntID.
+			void erase(EntID eid)
+			{
+				if (!alive(eid))
+					return;
+
+				auto& slot = slots[eid.index()];
+				slot.value = T();
+				slot.alive = false;
+				++slot.generation;
+
+				free_indices.push_back(eid.index());
+				--count;
+			}
+
+			/// True if the EntID refers to a living Entity.
+			bool alive(EntID eid) const
+			{
+				return eid.index() < slots.size() && slots[eid.index()].generation == eid.generation() && slots[eid.index()].alive;
+			}
+
+			/// True if the slot holds a living Entity.
+			bool alive_at(uint32_t index) const
+			{
+				return slots[index].alive;
+			}
+
+			/// EntID of the Entity currently in a slot.
+			EntID id_at(uint32_t index) const
+			{
+				return {index, slots[index].generation};
+			}
+
+			T& operator[](uint32_t index)
+			{
+				return slots[index].value;
+			}
+
+			T const& operator[](uint32_t index) const
+			{
+				return slots[index].value;
+			}
+
+			/// Number of living Entities.
+			size_t size() const
+			{
+				return count;
+			}
+
+			/// Number of slots, living or not.
+			size_t capacity() const
+			{
+				return slots.size();
+			}
+		};
+
+		/*! Paged slot table
+		 *
+		 * A SlotTable split in fixed-size pages, which copies share: a copy
+		 * costs one step per page, and a page is copied the first time it is
+		 * written afterwards. Free indices are threaded through the slots, so
+		 * they are shared too.
+		 *
+		 * @tparam T Per-Entity value, default constructible.
+		 * @tparam AllocatorT Allocator for the pages.
+		 */
+		template<typename T, template<typename> class AllocatorT>
+		class PagedSlotTable
+		{
+			static constexpr uint32_t page_bits = 10;
+			static constexpr uint32_t page_size = 1u << page_bits;
+			static constexpr uint32_t npos = numeric_limits<uint32_t>::max();
+
+			struct Slot
+			{
+				T value;
+				uint32_t generation;
+				uint32_t next_free;
+				bool alive;
+			};
+
+			struct Page
+			{
+				array<Slot, page_size> slots;
+			};
+
+			vector<shared_ptr<Page>> pages;
+			uint32_t used = 0;
+			uint32_t free_head = npos;
+			size_t count = 0;
+
+			Slot const& slot(uint32_t index) const
+			{
+				return pages[index >> page_bits]->slots[index & (page_size - 1)];
+			}
+
+			/// Gives the page its own memory, if it is shared with a copy.
+			Slot& slot(uint32_t index)
+			{
+				auto& page = pages[index >> page_bits];
+				if (page.use_count() != 1)
+					page = allocate_shared<Page>(AllocatorT<Page>(), *page);
+
+				return page->slots[index & (page_size - 1)];
+			}
+
+		public:
+			/// Creates an Entity with the given value.
+			template<typename... Args>
+			EntID emplace(Args&& ... args)
+			{
+				uint32_t index;
+
+				if (free_head != npos)
+				{
+					index = free_head;
+
+					auto& slot = this->slot(index);
+					free_head = slot.next_free;
+					slot.value = T(std::forward<Args>(args)...);
+					slot.alive = true;
+				}
+				else
+				{
+					index = used++;
+					if ((index >> page_bits) == pages.size())
+						pages.push_back(allocate_shared<Page>(AllocatorT<Page>()));
+
+					slot(index) = {T(std::forward<Args>(args)...), 1, npos, true};
+				}
+
+				++count;
+				return {index, slot(index).generation};
+			}
+
+			/// Makes room for n more Entities.
+			void reserve(size_t n)
+			{
+				pages.reserve((used + n + page_size - 1) >> page_bits);
+			}
+
+			/// Erases an Entity, resetting its value. Does nothing for a dangling EntID.
+			void erase(EntID eid)
+			{
+				if (!alive(eid))
+					return;
+
+				auto& slot = this->slot(eid.index());
+				slot.value = T();
+				slot.alive = false;
+				++slot.generation;
+
+				slot.next_free = free_head;
+				free_head = eid.index();
+				--count;
+			}
+
+			/// True if the EntID refers to a living Entity.
+			bool alive(EntID eid) const
+			{
+				if (eid.index() >= used)
+					return false;
+
+				auto& slot = this->slot(eid.index());
+				return slot.generation == eid.generation() && slot.alive;
+			}
+
+			/// True if the slot holds a living Entity.
+			bool alive_at(uint32_t index) const
+			{
+				return slot(index).alive;
+			}
+
+			/// EntID of the Entity currently in a slot.
+			EntID id_at(uint32_t index) const
+			{
+				return {index, slot(index).generation};
+			}
+
+			T& operator[](uint32_t index)
+			{
+				return slot(index).value;
+			}
+
+			T const& operator[](uint32_t index) const
+			{
+				return slot(index).value;
+			}
+
+			/// Number of living Entities.
+			size_t size() const
+			{
+				return count;
+			}
+
+			/// Number of slots, living or not.
+			size_t capacity() const
+			{
+				return used;
+			}
+		};
+
+		template<typename T, template<typename> class AllocatorT>
+		constexpr uint32_t PagedSlotTable<T, AllocatorT>::page_bits;
+
+		template<typename T, template<typename> class AllocatorT>
+		constexpr uint32_t PagedSlotTable<T, AllocatorT>::page_size;
+
+		template<typename T, template<typename> class AllocatorT>
+		constexpr uint32_t PagedSlotTable<T, AllocatorT>::npos;
+
+		// Signals
+
+		/// Kinds of component events.
+		enum class Signal
+		{
+			construct,
+			update,
+			destroy
+		};
+
+		/*! Signal ID
+		 *
+		 * Handle to a listener, used to disconnect it.
+		 */
+		struct SignalID
+		{
+			GUID guid = 0;
+			Signal signal = Signal::construct;
+			uint64_t id = 0;
+		};
+
+		/*! Component signals
+		 *
+		 * Queues component events per type and kind, and delivers them in
+		 * batches on dispatch(): each listener receives the contiguous array
+		 * of the Entities concerned, in the order the events happened.
+		 *
+		 * Events are only queued for the types having a listener, so a
+		 * change of an unobserved type costs a branch.
+		 */
+		class Signals
+		{
+		public:
+			using Listener = function<void(EntID const*, size_t)>;
+
+		private:
+			struct Channel
+			{
+				GUID guid;
+				vector<EntID> queued;
+				vector<EntID> delivered;
+				vector<pair<uint64_t, Listener>> listeners;
+			};
+
+			static constexpr size_t num_signals = 3;
+
+			array<vector<Channel>, num_signals> channels;
+			uint64_t next_id = 0;
+
+		public:
+			/// Adds a listener, returning its ID.
+			SignalID connect(GUID guid, Signal signal, Listener listener)
+			{
+				auto& list = channels[size_t(signal)];
+				auto pos = lower_bound(begin(list), end(list), guid, [](Channel const& c, GUID g) { return c.guid < g; });
+
+				if (pos == end(list) || pos->guid != guid)
+				{
+					pos = list.emplace(pos);
+					pos->guid = guid;
+				}
+
+				SignalID rv;
+				rv.guid = guid;
+				rv.signal = signal;
+				rv.id = ++next_id;
+				pos->listeners.emplace_back(rv.id, move(listener));
+				return rv;
+			}
+
+			/// Removes a listener. The last listener of a type drops its queued events.
+			void disconnect(SignalID sid)
+			{
+				auto& list = channels[size_t(sid.signal)];
+				auto channel = find(sid.guid, sid.signal);
+
+				if (!channel)
+					return;
+
+				auto& listeners = channel->listeners;
+				listeners.erase(remove_if(begin(listeners), end(listeners), [&](pair<uint64_t, Listener> const& l) { return l.first == sid.id; }), end(listeners));
+
+				if (listeners.empty())
+					list.erase(list.begin() + (channel - list.data()));
+			}
+
+			/// True if any type has a listener for the signal.
+			bool observed(Signal signal) const
+			{
+				return !channels[size_t(signal)].empty();
+			}
+
+			/// Queues an event, if the type has a listener.
+			void emit(GUID guid, Signal signal, EntID eid)
+			{
+				if (observed(signal))
+					if (auto channel = find(guid, signal))
+						channel->queued.push_back(eid);
+			}
+
+			/// Queues one event per Entity, if the type has a listener.
+			void emit(GUID guid, Signal signal, EntID const* eids, size_t count)
+			{
+				if (observed(signal))
+					if (auto channel = find(guid, signal))
+						channel->queued.insert(channel->queued.end(), eids, eids + count);
+			}
+
+			/*! Deliver the queued events.
+			 *
+			 * Construct events are delivered first, then update events, then
+			 * destroy events. Events queued by the listeners are delivered by
+			 * the next dispatch().
+			 *
+			 * @warning
+			 * Listeners must not connect or disconnect listeners.
+			 */
+			void dispatch()
+			{
+				for (auto& list : channels)
+					for (auto& channel : list)
+						swap(channel.queued, channel.delivered);
+
+				for (auto& list : channels)
+				{
+					for (auto& channel : list)
+					{
+						if (channel.delivered.empty())
+							continue;
+
+						for (auto& listener : channel.listeners)
+							listener.second(channel.delivered.data(), channel.delivered.size());
+
+						channel.delivered.clear();
+					}
+				}
+			}
+
+			/// Drops the queued events.
+			void clear()
+			{
+				for (auto& list : channels)
+					for (auto& channel : list)
+						channel.queued.clear();
+			}
+
+		private:
+			Channel* find(GUID guid, Signal signal)
+			{
+				auto& list = channels[size_t(signal)];
+				auto pos = lower_bound(begin(list), end(list), guid, [](Channel const& c, GUID g) { return c.guid < g; });
+				return pos != end(list) && pos->guid == guid ? &*pos : nullptr;
+			}
+		};
+
 		// Component
 		template<typename T>
 		class Component
@@ -132,7 +834,7 @@ namespace ginseng
 
 		class Entity
 		{
-			template<template<typename> class AllocatorT>
+			template<template<typename> class AllocatorT, typename StorageT>
 			friend class Database;
 
 			using ComponentVec = vector<ComponentData>;
@@ -160,6 +862,27 @@ namespace ginseng
 		struct Tag
 		{ };
 
+		/*! Change filter.
+		 *
+		 * As a visitor parameter, matches Entities whose T was created or
+		 * written (through a `T&` or `ComInfo<T>` visitor parameter) after the
+		 * tick given to visit(). T must not be a Tag.
+		 */
+		template<typename T>
+		struct Changed
+		{ };
+
+		// Tags carry no data, so they never occupy any storage.
+		template<typename T>
+		struct TypeInfoOf<Tag<T>>
+		{
+			static TypeInfo const* get()
+			{
+				static TypeInfo const info = {getGUID<Tag<T>>(), 0, 1, true, nullptr, nullptr, nullptr};
+				return &info;
+			}
+		};
+
 		// Traits
 		struct ComponentTags
 		{
@@ -173,6 +896,8 @@ namespace ginseng
 			{ };
 			struct eid
 			{ };
+			struct changed
+			{ };
 		};
 
 		template<typename DB, typename Component, template<typename> class ComInfo = DB::template ComInfo>
@@ -203,6 +928,13 @@ namespace ginseng
 			using com = Component;
 		};
 
+		template<typename DB, typename Component, template<typename> class ComInfo>
+		struct ComponentTraits<DB, Changed<Component>, ComInfo>
+		{
+			using tag = ComponentTags::changed;
+			using com = Component;
+		};
+
 		template<typename DB, template<typename> class ComInfo>
 		struct ComponentTraits<DB, typename DB::EntID, ComInfo>
 		{
@@ -216,45 +948,52 @@ namespace ginseng
 		struct Applier<DB, EntID, HeadCom, TailComs...>
 		{
 			template<typename Traits, typename Visitor, typename... Args>
-			static void helper(ComponentTags::normal, EntID eid, Visitor&& visitor, Args&& ... args)
+			static void helper(ComponentTags::normal, DB const& db, EntID eid, Visitor&& visitor, Args&& ... args)
 			{
-				if (auto com_info = eid.template get<typename Traits::com>())
-					return Applier<DB, EntID, TailComs...>::try_apply(eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., com_info.data());
+				if (auto com_info = db.template get<typename Traits::com>(eid))
+					return Applier<DB, EntID, TailComs...>::try_apply(db, eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., com_info.data());
 			}
 
 			template<typename Traits, typename Visitor, typename... Args>
-			static void helper(ComponentTags::inverted, EntID eid, Visitor&& visitor, Args&& ... args)
+			static void helper(ComponentTags::inverted, DB const& db, EntID eid, Visitor&& visitor, Args&& ... args)
 			{
-				if (auto com_info = eid.template get<typename Traits::com>())
+				if (auto com_info = db.template get<typename Traits::com>(eid))
 					return;
-				return Applier<DB, EntID, TailComs...>::try_apply(eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., Not<typename Traits::com>{});
+				return Applier<DB, EntID, TailComs...>::try_apply(db, eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., Not<typename Traits::com>{});
 			}
 
 			template<typename Traits, typename Visitor, typename... Args>
-			static void helper(ComponentTags::info, EntID eid, Visitor&& visitor, Args&& ... args)
+			static void helper(ComponentTags::info, DB const& db, EntID eid, Visitor&& visitor, Args&& ... args)
 			{
-				if (auto com_info = eid.template get<typename Traits::com>())
-					return Applier<DB, EntID, TailComs...>::try_apply(eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., com_info);
+				if (auto com_info = db.template get<typename Traits::com>(eid))
+					return Applier<DB, EntID, TailComs...>::try_apply(db, eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., com_info);
 			}
 
 			template<typename Traits, typename Visitor, typename... Args>
-			static void helper(ComponentTags::tagged, EntID eid, Visitor&& visitor, Args&& ... args)
+			static void helper(ComponentTags::tagged, DB const& db, EntID eid, Visitor&& visitor, Args&& ... args)
 			{
-				if (auto com_info = eid.template get<typename Traits::com>())
-					return Applier<DB, EntID, TailComs...>::try_apply(eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., typename Traits::com{});
+				if (auto com_info = db.template get<typename Traits::com>(eid))
+					return Applier<DB, EntID, TailComs...>::try_apply(db, eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., typename Traits::com{});
 			}
 
 			template<typename Traits, typename Visitor, typename... Args>
-			static void helper(ComponentTags::eid, EntID eid, Visitor&& visitor, Args&& ... args)
+			static void helper(ComponentTags::changed, DB const& db, EntID eid, Visitor&& visitor, Args&& ... args)
 			{
-				return Applier<DB, EntID, TailComs...>::try_apply(eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., eid);
+				if (auto com_info = db.template get<typename Traits::com>(eid))
+					return Applier<DB, EntID, TailComs...>::try_apply(db, eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., Changed<typename Traits::com>{});
+			}
+
+			template<typename Traits, typename Visitor, typename... Args>
+			static void helper(ComponentTags::eid, DB const& db, EntID eid, Visitor&& visitor, Args&& ... args)
+			{
+				return Applier<DB, EntID, TailComs...>::try_apply(db, eid, std::forward<Visitor>(visitor), std::forward<Args>(args)..., eid);
 			}
 
 			template<typename Visitor, typename... Args>
-			static void try_apply(EntID eid, Visitor&& visitor, Args&& ... args)
+			static void try_apply(DB const& db, EntID eid, Visitor&& visitor, Args&& ... args)
 			{
 				using Traits = ComponentTraits<DB, HeadCom>;
-				return helper<Traits>(typename Traits::tag{}, eid, std::forward<Visitor>(visitor), std::forward<Args>(args)...);
+				return helper<Traits>(typename Traits::tag{}, db, eid, std::forward<Visitor>(visitor), std::forward<Args>(args)...);
 			}
 		};
 
@@ -262,51 +1001,271 @@ namespace ginseng
 		struct Applier<DB, EntID>
 		{
 			template<typename Visitor, typename... Args>
-			static void try_apply(EntID eid, Visitor&& visitor, Args&& ... args)
+			static void try_apply(DB const& db, EntID eid, Visitor&& visitor, Args&& ... args)
 			{
+				(void) db;
 				(void) eid;
 				std::forward<Visitor>(visitor)(std::forward<Args>(args)...);
 			}
 		};
 
-		template<typename DB, typename... Components>
+		template<typename DB, typename Parameters, bool IsConst, typename... Components>
 		struct VisitorTraitsImpl
 		{
 			using EntID = typename DB::EntID;
+			using components = TypeList<Components...>;
+			using parameters = Parameters;
+
+			/// True if the visitor can be called through a const reference.
+			static constexpr bool is_const_call = IsConst;
 
 			template<typename Visitor>
-			static void apply(EntID eid, Visitor&& visitor)
+			static void apply(DB const& db, EntID eid, Visitor&& visitor)
 			{
-				Applier<DB, EntID, Components...>::try_apply(eid, std::forward<Visitor>(visitor));
+				Applier<DB, EntID, Components...>::try_apply(db, eid, std::forward<Visitor>(visitor));
 			}
 		};
 
 		template<typename DB, typename Visitor>
-		struct VisitorTraits : VisitorTraits<DB, decltype(&Visitor::operator())>
+		struct VisitorTraits : VisitorTraits<DB, decltype(&std::decay_t<Visitor>::operator())>
+		{ };
+
+		template<typename DB, typename R, typename... Ts>
+		struct VisitorTraits<DB, R(*)(Ts...)> : VisitorTraitsImpl<DB, TypeList<Ts...>, true, std::decay_t<Ts>...>
 		{ };
 
 		template<typename DB, typename R, typename... Ts>
-		struct VisitorTraits<DB, R(*)(Ts...)> : VisitorTraitsImpl<DB, std::decay_t < Ts> ...>
+		struct VisitorTraits<DB, R(&)(Ts...)> : VisitorTraitsImpl<DB, TypeList<Ts...>, true, std::decay_t<Ts>...>
 		{ };
 
 		template<typename DB, typename Visitor, typename R, typename... Ts>
-		struct VisitorTraits<DB, R(Visitor::*)(Ts...)> : VisitorTraitsImpl<DB, std::decay_t < Ts> ...>
+		struct VisitorTraits<DB, R(Visitor::*)(Ts...)> : VisitorTraitsImpl<DB, TypeList<Ts...>, false, std::decay_t<Ts>...>
 		{ };
 
 		template<typename DB, typename Visitor, typename R, typename... Ts>
-		struct VisitorTraits<DB, R(Visitor::*)(Ts...) const> : VisitorTraitsImpl<DB, std::decay_t < Ts> ...>
+		struct VisitorTraits<DB, R(Visitor::*)(Ts...) const> : VisitorTraitsImpl<DB, TypeList<Ts...>, true, std::decay_t<Ts>...>
 		{ };
 
 		template<typename DB, typename Visitor, typename R, typename... Ts>
-		struct VisitorTraits<DB, R(Visitor::*)(Ts...)&> : VisitorTraitsImpl<DB, std::decay_t < Ts> ...>
+		struct VisitorTraits<DB, R(Visitor::*)(Ts...)&> : VisitorTraitsImpl<DB, TypeList<Ts...>, false, std::decay_t<Ts>...>
 		{ };
 
 		template<typename DB, typename Visitor, typename R, typename... Ts>
-		struct VisitorTraits<DB, R(Visitor::*)(Ts...) const&> : VisitorTraitsImpl<DB, std::decay_t < Ts> ...>
+		struct VisitorTraits<DB, R(Visitor::*)(Ts...) const&> : VisitorTraitsImpl<DB, TypeList<Ts...>, true, std::decay_t<Ts>...>
 		{ };
 
 		template<typename DB, typename Visitor, typename R, typename... Ts>
-		struct VisitorTraits<DB, R(Visitor::*)(Ts...)&&> : VisitorTraitsImpl<DB, std::decay_t < Ts> ...>
+		struct VisitorTraits<DB, R(Visitor::*)(Ts...)&&> : VisitorTraitsImpl<DB, TypeList<Ts...>, false, std::decay_t<Ts>...>
+		{ };
+
+		// Access
+
+		template<typename List, typename T>
+		struct ListContains;
+
+		template<typename T>
+		struct ListContains<TypeList<>, T> : false_type
+		{ };
+
+		template<typename Head, typename... Tail, typename T>
+		struct ListContains<TypeList<Head, Tail...>, T>
+				: integral_constant<bool, is_same<Head, T>::value || ListContains<TypeList<Tail...>, T>::value>
+		{ };
+
+		template<typename List>
+		struct ListUnique : true_type
+		{ };
+
+		template<typename Head, typename... Tail>
+		struct ListUnique<TypeList<Head, Tail...>>
+				: integral_constant<bool, !ListContains<TypeList<Tail...>, Head>::value && ListUnique<TypeList<Tail...>>::value>
+		{ };
+
+		template<typename A, typename B>
+		struct ListIntersects;
+
+		template<typename B>
+		struct ListIntersects<TypeList<>, B> : false_type
+		{ };
+
+		template<typename Head, typename... Tail, typename B>
+		struct ListIntersects<TypeList<Head, Tail...>, B>
+				: integral_constant<bool, ListContains<B, Head>::value || ListIntersects<TypeList<Tail...>, B>::value>
+		{ };
+
+		template<typename... Lists>
+		struct ListConcat;
+
+		template<>
+		struct ListConcat<>
+		{
+			using type = TypeList<>;
+		};
+
+		template<typename... As>
+		struct ListConcat<TypeList<As...>>
+		{
+			using type = TypeList<As...>;
+		};
+
+		template<typename... As, typename... Bs, typename... Rest>
+		struct ListConcat<TypeList<As...>, TypeList<Bs...>, Rest...> : ListConcat<TypeList<As..., Bs...>, Rest...>
+		{ };
+
+		/// Scalar type of a batch visitor parameter, const for `T const`.
+		template<typename T>
+		using LaneType = conditional_t<is_const<T>::value,
+				typename Lanes<remove_const_t<T>>::type const,
+				typename Lanes<remove_const_t<T>>::type>;
+
+		/// Components written by a batch visitor: the ones not given as const.
+		template<typename... Ts>
+		using LaneWrites = typename ListConcat<conditional_t<is_const<Ts>::value, TypeList<>, TypeList<Ts>>...>::type;
+
+		template<typename T>
+		struct LaneCheck
+		{
+			using Com = remove_const_t<T>;
+			using Scalar = typename Lanes<Com>::type;
+
+			static_assert(Lanes<Com>::count != 0, "Batch visits need a Lanes specialization of each component");
+			static_assert(sizeof(Com) == sizeof(Scalar) * Lanes<Com>::count && is_standard_layout<Com>::value,
+			              "Components visited in batches must be made of their lanes only");
+			static_assert(is_trivially_copyable<Com>::value, "Components visited in batches must be trivially copyable");
+
+			static constexpr bool value = true;
+		};
+
+		/*! Component access of a single visitor parameter.
+		 *
+		 * `T&` writes T, `T const&` and `T` read T, and `ComInfo<T>` writes T
+		 * since it hands out a mutable reference. `Changed<T>` reads the change
+		 * ticks of T, which writers update. Tags, Not<> and EntIDs only test
+		 * for presence, which does not count as an access.
+		 */
+		template<typename DB, typename Param, typename TagT = typename ComponentTraits<DB, std::decay_t<Param>>::tag>
+		struct ParamAccess
+		{
+			using reads = TypeList<>;
+			using writes = TypeList<>;
+		};
+
+		template<typename DB, typename Param>
+		struct ParamAccess<DB, Param, ComponentTags::normal>
+		{
+			static constexpr bool is_write = is_lvalue_reference<Param>::value && !is_const<remove_reference_t<Param>>::value;
+
+			using reads = conditional_t<is_write, TypeList<>, TypeList<std::decay_t<Param>>>;
+			using writes = conditional_t<is_write, TypeList<std::decay_t<Param>>, TypeList<>>;
+		};
+
+		template<typename DB, typename Param>
+		struct ParamAccess<DB, Param, ComponentTags::info>
+		{
+			using reads = TypeList<>;
+			using writes = TypeList<typename ComponentTraits<DB, std::decay_t<Param>>::com>;
+		};
+
+		template<typename DB, typename Param>
+		struct ParamAccess<DB, Param, ComponentTags::changed>
+		{
+			using reads = TypeList<typename ComponentTraits<DB, std::decay_t<Param>>::com>;
+			using writes = TypeList<>;
+		};
+
+		template<typename DB, typename Parameters>
+		struct AccessImpl;
+
+		template<typename DB, typename... Ts>
+		struct AccessImpl<DB, TypeList<Ts...>>
+		{
+			using reads = typename ListConcat<typename ParamAccess<DB, Ts>::reads...>::type;
+			using writes = typename ListConcat<typename ParamAccess<DB, Ts>::writes...>::type;
+
+			static constexpr bool has_info = !is_same<
+					TypeList<>,
+					typename ListConcat<conditional_t<is_same<typename ComponentTraits<DB, std::decay_t<Ts>>::tag, ComponentTags::info>::value, TypeList<Ts>, TypeList<>>...>::type
+			>::value;
+		};
+
+		/*! Visitor access
+		 *
+		 * Component types read and written by a visitor, derived from its
+		 * signature at compile time.
+		 *
+		 * @tparam DB Database type.
+		 * @tparam Visitor Visitor type.
+		 */
+		template<typename DB, typename Visitor>
+		struct VisitorAccess : AccessImpl<DB, typename VisitorTraits<DB, Visitor>::parameters>
+		{
+			using Base = AccessImpl<DB, typename VisitorTraits<DB, Visitor>::parameters>;
+
+			/// True if the visitor writes no component.
+			static constexpr bool read_only = is_same<TypeList<>, typename Base::writes>::value;
+		};
+
+		/*! Test two visitors for conflicting access.
+		 *
+		 * Two visitors conflict if one of them writes a component type that
+		 * the other reads or writes. Visitors that do not conflict may visit
+		 * the same Database concurrently.
+		 *
+		 * @tparam DB Database type.
+		 * @tparam A First visitor type.
+		 * @tparam B Second visitor type.
+		 * @return True if the visitors conflict.
+		 */
+		template<typename DB, typename A, typename B>
+		constexpr bool conflicts()
+		{
+			using AccessA = VisitorAccess<DB, A>;
+			using AccessB = VisitorAccess<DB, B>;
+
+			return ListIntersects<typename AccessA::writes, typename ListConcat<typename AccessB::reads, typename AccessB::writes>::type>::value
+			       || ListIntersects<typename AccessB::writes, typename AccessA::reads>::value;
+		}
+
+		/*! Compile-time checks for parallel visits.
+		 *
+		 * A parallel visitor is shared by every worker, so its call operator
+		 * must be const. It must not take ComInfo parameters, whose ComIDs
+		 * could be used to change the Database structure mid-visit.
+		 */
+		template<typename DB, typename Visitor>
+		struct ParallelVisitCheck
+		{
+			static_assert(VisitorTraits<DB, Visitor>::is_const_call, "parallel_visit requires a visitor with a const call operator");
+			static_assert(!VisitorAccess<DB, Visitor>::has_info, "parallel_visit does not accept ComInfo parameters");
+
+			static constexpr bool value = true;
+		};
+
+		// Storage policies
+
+		/*! List storage
+		 *
+		 * Default storage policy. Entities live in a SlotTable, addressed by
+		 * generational indices, and each Entity owns a sorted vector of
+		 * type-erased components.
+		 */
+		struct ListStorage
+		{ };
+
+		/*! Archetype storage
+		 *
+		 * Entities sharing the same set of components are packed together in
+		 * fixed-size chunks, with one contiguous array per component type.
+		 */
+		struct ArchetypeStorage
+		{ };
+
+		/*! Sparse storage
+		 *
+		 * Each component type has its own pool: a sparse set mapping Entities
+		 * to a dense array of components.
+		 */
+		struct SparseStorage
 		{ };
 
 		/*! Database
@@ -319,108 +1278,26 @@ namespace ginseng
 		 * considered "thread-safe".
 		 *
 		 * @tparam AllocatorT Component allocator.
+		 * @tparam StorageT Storage policy.
 		 */
-		template<template<typename> class AllocatorT = allocator>
+		template<template<typename> class AllocatorT = allocator, typename StorageT = ListStorage>
 		class Database
 		{
-			template<typename T>
-			using AllocList = list<T, AllocatorT<T>>;
+			SlotTable<Entity, AllocatorT> entities;
+			Signals signals;
 
-			AllocList<Entity> entities;
+			uint64_t structure_version = 0;
 
 		public:
 			// IDs
-			// forward declarations needed for EntID
+
+			using EntID = _detail::EntID;
 
 			class ComID;
 
 			template<typename Com>
 			class ComInfo;
 
-			/*! Entity ID
-			 *
-			 * A handle to an Entity. Very lightweight.
-			 */
-			class EntID
-			{
-				friend class Database;
-
-				typename AllocList<Entity>::const_iterator iter;
-
-			public:
-				/*! Query the Entity for a component.
-				 *
-				 * Queries the Entity for the given component type.
-				 * If found, returns a valid ComInfo object for the requested
-				 * component.
-				 * Otherwise, returns an invalid ComInfo object.
-				 *
-				 * @tparam T Explicit type of component.
-				 * @return ComInfo for the requested component.
-				 */
-				template<typename T>
-				ComInfo<T> get() const
-				{
-					ComID cid;
-
-					GUID guid = getGUID<T>();
-					auto& comvec = iter->components;
-
-					auto pos = lower_bound(begin(comvec), end(comvec), guid);
-
-					cid.eid = *this;
-					cid.iter = pos;
-
-					if (pos != end(comvec) && pos->guid() == guid)
-						return {cid};
-
-					return {};
-				}
-
-				/*! Query the Entity for multiple components.
-				 *
-				 * Returns a tuple containing results equivalent to multiple
-				 * calls to get().
-				 *
-				 * For example, if `eid.getComs<X,Y,Z>()` is called, it is
-				 * equivalent to calling
-				 * `std::make_tuple(get<X>(),get<Y>(),get<Z>())`.
-				 *
-				 * @tparam Ts Explicit component types.
-				 * @return Tuple of results equivalent to get().
-				 */
-				template<typename... Ts>
-				tuple<ComInfo<Ts>...> coms() const
-				{
-					return make_tuple(get<Ts>()...);
-				}
-
-				/*! Compares this EntID to another for equivalence.
-				 *
-				 * Returns true only if the two EntIDs are handles to the same
-				 * Entity.
-				 *
-				 * @param other The EntID to compare to this.
-				 * @return True if EntIDs are equivalent.
-				 */
-				bool operator==(EntID const& other) const
-				{
-					return (iter == other.iter);
-				}
-
-				/*! Compares this EntID to another for ordering.
-				 *
-				 * Provides a strict weak ordering for EntIDs.
-				 *
-				 * @param other The EntID to compare to this.
-				 * @return True if this should be ordered before other.
-				 */
-				bool operator<(EntID const& other) const
-				{
-					return (&*iter < &*other.iter);
-				}
-			};
-
 			/*! Component ID
 			 *
 			 * A handle to a type-erased component. Very lightweight.
@@ -606,14 +1483,46 @@ namespace ginseng
 			 */
 			EntID create_entity()
 			{
-				EntID rv;
-				rv.iter = entities.emplace(end(entities));
+				++structure_version;
+				return entities.emplace();
+			}
+
+			/*! Creates several Entities at once.
+			 *
+			 * Creates n Entities, each with a copy of the given components.
+			 * Room for the Entities and their component lists is reserved
+			 * up front.
+			 *
+			 * @param n Number of Entities to create.
+			 * @param coms Component values, of distinct types.
+			 * @return EntIDs of the new Entities.
+			 */
+			template<typename... Ts>
+			vector<EntID> create_entities(size_t n, Ts const& ... coms)
+			{
+				static_assert(ListUnique<TypeList<Ts...>>::value, "Component types must be distinct");
+
+				vector<EntID> rv;
+				rv.reserve(n);
+				entities.reserve(n);
+
+				++structure_version;
+
+				for (size_t i = 0; i < n; ++i)
+				{
+					EntID eid = entities.emplace();
+					entities[eid.index()].components.reserve(sizeof...(Ts));
+					(void) initializer_list<int>{(create_component(eid, coms), 0)...};
+					rv.push_back(eid);
+				}
+
 				return rv;
 			}
 
 			/*! Destroys an Entity.
 			 *
 			 * Destroys the given Entity and all associated components.
+			 * Does nothing if the EntID is dangling.
 			 *
 			 * @warning
 			 * All components associated with the Entity are destroyed.
@@ -624,7 +1533,12 @@ namespace ginseng
 			 */
 			void erase_entity(EntID eid)
 			{
-				entities.erase(eid.iter);
+				if (!entities.alive(eid))
+					return;
+
+				emit_all(eid, Signal::destroy);
+				entities.erase(eid);
+				++structure_version;
 			}
 
 			/*! Emplace an Entity into this Database.
@@ -636,8 +1550,9 @@ namespace ginseng
 			 */
 			EntID emplace_entity(Entity&& ent)
 			{
-				EntID rv;
-				rv.iter = entities.emplace(end(entities), move(ent));
+				EntID rv = entities.emplace(move(ent));
+				++structure_version;
+				emit_all(rv, Signal::construct);
 				return rv;
 			}
 
@@ -653,11 +1568,77 @@ namespace ginseng
 			 */
 			Entity displace_entity(EntID eid)
 			{
-				Entity rv = move(*entities.erase(eid.iter, eid.iter));
-				entities.erase(eid.iter);
+				assert(valid(eid) && "Dangling EntID");
+				emit_all(eid, Signal::destroy);
+				Entity rv = move(entities[eid.index()]);
+				entities.erase(eid);
+				++structure_version;
 				return rv;
 			}
 
+			/*! Test an EntID.
+			 *
+			 * @param eid EntID to test.
+			 * @return True if the EntID refers to a living Entity.
+			 */
+			bool valid(EntID eid) const
+			{
+				return entities.alive(eid);
+			}
+
+			/*! Query an Entity for a component.
+			 *
+			 * Queries the Entity for the given component type.
+			 * If found, returns a valid ComInfo object for the requested
+			 * component.
+			 * Otherwise, or if the EntID is dangling, returns an invalid ComInfo
+			 * object.
+			 *
+			 * @tparam T Explicit type of component.
+			 * @param eid Entity to query.
+			 * @return ComInfo for the requested component.
+			 */
+			template<typename T>
+			ComInfo<T> get(EntID eid) const
+			{
+				if (!entities.alive(eid))
+					return {};
+
+				ComID cid;
+
+				GUID guid = getGUID<T>();
+				auto& comvec = entities[eid.index()].components;
+
+				auto pos = lower_bound(begin(comvec), end(comvec), guid);
+
+				cid.eid = eid;
+				cid.iter = pos;
+
+				if (pos != end(comvec) && pos->guid() == guid)
+					return {cid};
+
+				return {};
+			}
+
+			/*! Query an Entity for multiple components.
+			 *
+			 * Returns a tuple containing results equivalent to multiple
+			 * calls to get().
+			 *
+			 * For example, if `db.coms<X,Y,Z>(eid)` is called, it is
+			 * equivalent to calling
+			 * `std::make_tuple(db.get<X>(eid),db.get<Y>(eid),db.get<Z>(eid))`.
+			 *
+			 * @tparam Ts Explicit component types.
+			 * @param eid Entity to query.
+			 * @return Tuple of results equivalent to get().
+			 */
+			template<typename... Ts>
+			tuple<ComInfo<Ts>...> coms(EntID eid) const
+			{
+				return make_tuple(get<Ts>(eid)...);
+			}
+
 			// Component functions
 
 			/*! Create new component.
@@ -678,11 +1659,12 @@ namespace ginseng
 			template<typename T>
 			ComInfo<T> create_component(EntID eid, T com)
 			{
+				assert(valid(eid) && "Dangling EntID");
 				ComID cid;
 				GUID guid = getGUID<T>();
 				AllocatorT<Component<T>> alloc;
 
-				auto& comvec = entities.erase(eid.iter, eid.iter)->components;
+				auto& comvec = entities[eid.index()].components;
 				auto pos = lower_bound(begin(comvec), end(comvec), guid);
 				cid.eid = eid;
 
@@ -690,11 +1672,14 @@ namespace ginseng
 				{
 					cid.iter = pos;
 					cid.template cast<T>() = move(com);
+					signals.emit(guid, Signal::update, eid);
 				}
 				else
 				{
 					auto ptr = allocate_shared<Component<T>>(alloc, move(com));
 					cid.iter = comvec.emplace(pos, guid, move(ptr));
+					++structure_version;
+					signals.emit(guid, Signal::construct, eid);
 				}
 
 				return {cid};
@@ -718,21 +1703,44 @@ namespace ginseng
 			template<typename T>
 			ComInfo<Tag<T>> create_component(EntID eid, Tag<T> com)
 			{
+				assert(valid(eid) && "Dangling EntID");
 				ComID cid;
 				GUID guid = getGUID<Tag<T>>();
 
-				auto& comvec = entities.erase(eid.iter, eid.iter)->components;
+				auto& comvec = entities[eid.index()].components;
 				auto pos = lower_bound(begin(comvec), end(comvec), guid);
 				cid.eid = eid;
 
 				if (pos != end(comvec) && pos->guid() == guid)
+				{
 					cid.iter = pos;
+				}
 				else
+				{
 					cid.iter = comvec.emplace(pos, guid, nullptr);
+					++structure_version;
+					signals.emit(guid, Signal::construct, eid);
+				}
 
 				return {cid};
 			}
 
+			/*! Create a component on several Entities.
+			 *
+			 * Equivalent to calling create_component() with each EntID and
+			 * the value at the same position.
+			 *
+			 * @param eids Entities to attach the components to.
+			 * @param coms Component values, one per Entity.
+			 * @param count Number of Entities.
+			 */
+			template<typename T>
+			void create_components(EntID const* eids, T const* coms, size_t count)
+			{
+				for (size_t i = 0; i < count; ++i)
+					create_component(eids[i], coms[i]);
+			}
+
 			/*! Erase a component.
 			 *
 			 * Destroys the given component and disassociates it from its Entity.
@@ -745,8 +1753,11 @@ namespace ginseng
 			 */
 			void erase_component(ComID cid)
 			{
-				auto& comvec = entities.erase(cid.eid.iter, cid.eid.iter)->components;
+				signals.emit(cid.iter->guid(), Signal::destroy, cid.eid);
+
+				auto& comvec = entities[cid.eid.index()].components;
 				comvec.erase(cid.iter);
+				++structure_version;
 			}
 
 			/*! Emplace component data into this Database.
@@ -764,21 +1775,27 @@ namespace ginseng
 			 */
 			ComID emplace_component(EntID eid, ComponentData&& dat)
 			{
+				assert(valid(eid) && "Dangling EntID");
 				ComID rv;
-				auto& comvec = entities.erase(eid.iter, eid.iter)->components;
+				auto& comvec = entities[eid.index()].components;
 				GUID guid = dat.guid();
 
 				auto pos = lower_bound(begin(comvec), end(comvec), dat);
 
 				rv.eid = eid;
+				++structure_version;
 
 				if (pos != end(comvec) && pos->guid() == guid)
 				{
 					rv.iter = pos;
 					pos->val() = move(dat.val());
+					signals.emit(guid, Signal::update, eid);
 				}
 				else
+				{
 					rv.iter = comvec.emplace(pos, move(dat));
+					signals.emit(guid, Signal::construct, eid);
+				}
 
 				return rv;
 			}
@@ -796,9 +1813,12 @@ namespace ginseng
 			 */
 			ComponentData displace_component(ComID cid)
 			{
-				auto& comvec = entities.erase(cid.eid.iter, cid.eid.iter)->components;
+				signals.emit(cid.iter->guid(), Signal::destroy, cid.eid);
+
+				auto& comvec = entities[cid.eid.index()].components;
 				ComponentData rv = move(*comvec.erase(cid.iter, cid.iter));
 				comvec.erase(cid.iter);
+				++structure_version;
 				return rv;
 			}
 
@@ -806,13 +1826,13 @@ namespace ginseng
 			void visit(Visitor&& visitor)
 			{
 				using Traits = VisitorTraits<Database, Visitor>;
+				ProfileScope profile("ginseng::visit");
 
 				// Query loop
-				for (auto i = begin(entities), e = end(entities); i != e; ++i)
+				for (uint32_t i = 0, e = uint32_t(entities.capacity()); i != e; ++i)
 				{
-					EntID eid;
-					eid.iter = i;
-					Traits::apply(eid, visitor);
+					if (entities.alive_at(i))
+						Traits::apply(*this, entities.id_at(i), visitor);
 				}
 			}
 
@@ -820,18 +1840,177 @@ namespace ginseng
 			void visit(Visitor&& visitor) const
 			{
 				using Traits = VisitorTraits<Database, Visitor>;
+				ProfileScope profile("ginseng::visit");
 
 				// Query loop
-				for (auto i = begin(entities), e = end(entities); i != e; ++i)
+				for (uint32_t i = 0, e = uint32_t(entities.capacity()); i != e; ++i)
 				{
-					EntID eid;
-					eid.iter = i;
-					Traits::apply(eid, visitor);
+					if (entities.alive_at(i))
+						Traits::apply(*this, entities.id_at(i), visitor);
 				}
 			}
 
+			/*! Visit the Database for changes.
+			 *
+			 * This storage does not track changes: `Changed<T>` parameters match
+			 * every T, so this is equivalent to visit().
+			 *
+			 * @param visitor Visitor to call.
+			 * @param since Change tick, ignored.
+			 */
+			template<typename Visitor>
+			void visit(Visitor&& visitor, uint64_t since)
+			{
+				(void) since;
+				visit(std::forward<Visitor>(visitor));
+			}
+
+			/*! Visit the Database in parallel.
+			 *
+			 * Equivalent to visit(), but the Entity slots are split in ranges of
+			 * about grain slots, which are visited concurrently by the given
+			 * executor. The executor must provide
+			 * `parallel_for(count, grain, f)`, calling `f(begin, end)` over
+			 * `[0, count)`.
+			 *
+			 * Each Entity is visited by exactly one thread, so writing to the
+			 * visited components is safe. The visitor is shared by every
+			 * thread: its call operator must be const, and it must not take
+			 * ComInfo parameters.
+			 *
+			 * @param executor Executor running the ranges.
+			 * @param visitor Visitor to call.
+			 * @param grain Approximate number of Entities per range.
+			 * @param since Change tick, ignored.
+			 */
+			template<typename Executor, typename Visitor>
+			void parallel_visit(Executor& executor, Visitor&& visitor, size_t grain = 1024, uint64_t since = 0)
+			{
+				using Traits = VisitorTraits<Database, Visitor>;
+				static_assert(ParallelVisitCheck<Database, Visitor>::value, "");
+				(void) since;
+				ProfileScope profile("ginseng::parallel_visit");
+
+				executor.parallel_for(entities.capacity(), grain, [&](size_t first, size_t last)
+				{
+					for (size_t i = first; i < last; ++i)
+					{
+						if (entities.alive_at(uint32_t(i)))
+							Traits::apply(*this, entities.id_at(uint32_t(i)), visitor);
+					}
+				});
+			}
+
 			// query
 
+			/*! View
+			 *
+			 * A lazy range over the Entities matching a set of parameters,
+			 * following the same rules as visitor parameters. Each element is a
+			 * `std::tuple<Ts...>` of references (or values) to the components.
+			 *
+			 * Iterating does not allocate. A View is invalidated by creating or
+			 * erasing components or Entities.
+			 *
+			 * @tparam Ts View parameters.
+			 */
+			template<typename... Ts>
+			class View
+			{
+				friend class Database;
+
+				Database* db;
+
+				explicit View(Database* d) : db(d)
+				{ }
+
+			public:
+				class iterator
+				{
+					friend class View;
+
+					Database* db;
+					uint32_t i;
+					uint32_t e;
+
+					iterator(Database* d, uint32_t first, uint32_t last) : db(d), i(first), e(last)
+					{
+						skip();
+					}
+
+					void skip()
+					{
+						while (i != e && !(db->entities.alive_at(i) && db->template view_test<Ts...>(db->entities.id_at(i))))
+							++i;
+					}
+
+				public:
+					using iterator_category = input_iterator_tag;
+					using value_type = tuple<Ts...>;
+					using difference_type = ptrdiff_t;
+					using pointer = void;
+					using reference = tuple<Ts...>;
+
+					reference operator*() const
+					{
+						EntID eid = db->entities.id_at(i);
+						return reference(db->template view_fetch<decay_t<Ts>>(eid, typename ComponentTraits<Database, decay_t<Ts>>::tag{})...);
+					}
+
+					iterator& operator++()
+					{
+						++i;
+						skip();
+						return *this;
+					}
+
+					iterator operator++(int)
+					{
+						iterator rv = *this;
+						++*this;
+						return rv;
+					}
+
+					bool operator==(iterator const& other) const
+					{
+						return i == other.i;
+					}
+
+					bool operator!=(iterator const& other) const
+					{
+						return i != other.i;
+					}
+				};
+
+				iterator begin() const
+				{
+					return {db, 0, uint32_t(db->entities.capacity())};
+				}
+
+				iterator end() const
+				{
+					auto e = uint32_t(db->entities.capacity());
+					return {db, e, e};
+				}
+			};
+
+			/*! Create a View of the Database.
+			 *
+			 * Returns a lazy range over the Entities matching the given
+			 * parameters, which follow the same rules as visitor parameters.
+			 * Usable with range-for and the standard algorithms.
+			 *
+			 * @tparam Ts View parameters.
+			 * @param since Change tick, ignored.
+			 * @return View of the matching Entities.
+			 */
+			template<typename... Ts>
+			View<Ts...> view(uint64_t since = 0)
+			{
+				(void) since;
+				return View<Ts...>(this);
+			}
+
 			/*! Query the Database.
 			 *
 			 * Queries the Database for Entities that match the given template parameters.
@@ -840,6 +2019,7 @@ namespace ginseng
 			 * `visit([](Ts...){})` and forwarding the visitor's parameters to each tuple.
 			 *
 			 * There will be one element in the returned vector for each entity visited.
+			 * Prefer view(), which does not allocate.
 			 *
 			 * @tparam Ts Query parameters.
 			 * @return Query results.
@@ -847,26 +2027,248 @@ namespace ginseng
 			template<typename... Ts>
 			std::vector <std::tuple<Ts...>> query()
 			{
-				std::vector <std::tuple<Ts...>> rv;
-				visit([&](Ts... params)
-				      {
-					      rv.emplace_back(std::forward<Ts>(params)...);
-				      });
-				return rv;
+				auto v = view<Ts...>();
+				return std::vector <std::tuple<Ts...>>(v.begin(), v.end());
 			}
 
 			// status functions
-			auto size() const -> decltype(entities.size())
+			size_t size() const
 			{
 				return entities.size();
 			}
+
+			/*! Release unused memory.
+			 *
+			 * Components of this storage live in their own allocations and are
+			 * never moved, so only the component lists of the Entities are
+			 * shrunk. Prefer the archetype or sparse storage for components
+			 * that are created and erased often.
+			 */
+			void compact()
+			{
+				for (uint32_t i = 0, e = uint32_t(entities.capacity()); i != e; ++i)
+					if (entities.alive_at(i))
+						entities[i].components.shrink_to_fit();
+			}
+
+			/*! Current change tick.
+			 *
+			 * This storage does not track changes, so this is always 0.
+			 *
+			 * @return Current change tick.
+			 */
+			uint64_t tick() const
+			{
+				return 0;
+			}
+
+			/*! Structure version.
+			 *
+			 * Changes whenever Entities or components are created or erased,
+			 * or components move in memory. While it stays the same, pointers
+			 * to components remain valid, and so does the absence of a
+			 * component.
+			 *
+			 * @return Structure version.
+			 */
+			uint64_t version() const
+			{
+				return structure_version;
+			}
+
+			/*! Mark a component as changed.
+			 *
+			 * This storage does not track changes; only signals the update.
+			 *
+			 * @tparam T Explicit type of component.
+			 * @param eid Entity owning the component.
+			 */
+			template<typename T>
+			void touch(EntID eid)
+			{
+				if (get<T>(eid))
+					signals.emit(getGUID<T>(), Signal::update, eid);
+			}
+
+			// Signals
+
+			/*! Listen to component creation.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities that gained a T since the previous dispatch().
+			 *
+			 * @tparam T Component type, which may be a Tag.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_construct(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::construct, std::forward<Func>(func));
+			}
+
+			/*! Listen to component updates.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities whose T was overwritten by create_component() or
+			 * marked by touch() since the previous dispatch(). Writes through
+			 * visitors, Views or get() are not signaled.
+			 *
+			 * @tparam T Component type.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_update(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::update, std::forward<Func>(func));
+			}
+
+			/*! Listen to component destruction.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities that lost their T, or were erased, since the
+			 * previous dispatch(). Erased Entities are no longer valid by then.
+			 *
+			 * @tparam T Component type, which may be a Tag.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_destroy(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::destroy, std::forward<Func>(func));
+			}
+
+			/*! Remove a listener.
+			 *
+			 * @param sid ID returned when connecting the listener.
+			 */
+			void disconnect(SignalID sid)
+			{
+				signals.disconnect(sid);
+			}
+
+			/*! Deliver the queued component events.
+			 *
+			 * The sync point of the signals: each listener is called once per
+			 * dispatch at most, with every event of its type and kind since the
+			 * previous dispatch. An Entity appears once per event, so it may
+			 * appear several times, or be gone already.
+			 *
+			 * Listeners may change the Database; the events they cause are
+			 * delivered by the next dispatch.
+			 */
+			void dispatch()
+			{
+				signals.dispatch();
+			}
+
+		private:
+			/// Signals an event for every component of an Entity.
+			void emit_all(EntID eid, Signal signal)
+			{
+				if (signals.observed(signal))
+					for (auto& com : entities[eid.index()].components)
+						signals.emit(com.guid(), signal, eid);
+			}
+
+			// View
+
+			template<typename... Ts>
+			bool view_test(EntID eid) const
+			{
+				bool matches = true;
+				(void) initializer_list<int>{(matches = matches && view_test_one<decay_t<Ts>>(eid, typename ComponentTraits<Database, decay_t<Ts>>::tag{}), 0)...};
+				return matches;
+			}
+
+			template<typename T, typename TagT>
+			bool view_test_one(EntID eid, TagT) const
+			{
+				return bool(get<typename ComponentTraits<Database, T>::com>(eid));
+			}
+
+			template<typename T>
+			bool view_test_one(EntID eid, ComponentTags::inverted) const
+			{
+				return !get<typename ComponentTraits<Database, T>::com>(eid);
+			}
+
+			template<typename T>
+			bool view_test_one(EntID, ComponentTags::eid) const
+			{
+				return true;
+			}
+
+			template<typename T>
+			T& view_fetch(EntID eid, ComponentTags::normal) const
+			{
+				return get<T>(eid).data();
+			}
+
+			template<typename T>
+			T view_fetch(EntID eid, ComponentTags::info) const
+			{
+				return get<typename ComponentTraits<Database, T>::com>(eid);
+			}
+
+			template<typename T>
+			T view_fetch(EntID, ComponentTags::tagged) const
+			{
+				return {};
+			}
+
+			template<typename T>
+			T view_fetch(EntID, ComponentTags::inverted) const
+			{
+				return {};
+			}
+
+			template<typename T>
+			T view_fetch(EntID, ComponentTags::changed) const
+			{
+				return {};
+			}
+
+			template<typename T>
+			EntID view_fetch(EntID eid, ComponentTags::eid) const
+			{
+				return eid;
+			}
 		};
 
 	} // namespace _detail
 
 	using _detail::ComponentData;
+	using _detail::EntID;
 	using _detail::Entity;
 	using _detail::Database;
+	using _detail::ListStorage;
+	using _detail::ArchetypeStorage;
+	using _detail::SparseStorage;
 	using _detail::Not;
 	using _detail::Tag;
+	using _detail::Changed;
+	using _detail::Signal;
+	using _detail::SignalID;
 } // namespace ginseng
+
+namespace std
+{
+	template<>
+	struct hash<ginseng::_detail::EntID>
+	{
+		size_t operator()(ginseng::_detail::EntID const& eid) const
+		{
+			return hash<uint64_t>()(eid.value());
+		}
+	};
+} // namespace std
+
+#include "ginseng/archetype.hpp"
+#include "ginseng/sparse.hpp"
+#include "ginseng/pool_allocator.hpp"
+#include "ginseng/command_buffer.hpp"
+#include "ginseng/snapshot.hpp"
+#include "ginseng/hierarchy.hpp"
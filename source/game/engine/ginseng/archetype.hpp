@@ -0,0 +1,2053 @@
+#pragma once
+
+#include "../ginseng.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <map>
+
+namespace ginseng
+{
+	namespace _detail
+	{
+		/*! Archetype Database
+		 *
+		 * An Entity component Database that groups Entities by their exact set
+		 * of components (their archetype). Each archetype stores its Entities in
+		 * fixed-size chunks, with one contiguous array per component type, so
+		 * visiting is a linear sweep over the chunks of matching archetypes only.
+		 *
+		 * Adding or removing a component moves the Entity to another archetype.
+		 * Transitions between archetypes are cached, so this costs one row copy.
+		 *
+		 * Chunk memory is obtained from the given allocator. Components whose
+		 * type is Relocatable are moved between rows and archetypes with a
+		 * memcpy.
+		 *
+		 * Changes are tracked per chunk and component type: `Changed<T>`
+		 * visits skip the chunks where no T was created or written since the
+		 * given tick.
+		 *
+		 * snapshot() captures the whole Database by sharing its chunks, which
+		 * are copied on write, and the Entity locations, kept in shared pages
+		 * of 1024 Entities. Taking and restoring a Snapshot cost one step per
+		 * chunk and per page, plus one copy per chunk or page written in
+		 * between.
+		 *
+		 * Entity and component values are not reachable outside of the
+		 * Database, therefore emplace/displace functions are not provided.
+		 *
+		 * @warning
+		 * This container does not perform any synchronization. Therefore, it is not
+		 * considered "thread-safe".
+		 *
+		 * @warning
+		 * Adding or removing components moves component data. References to
+		 * components of the affected archetypes are invalidated, including
+		 * during a visit().
+		 *
+		 * @tparam AllocatorT Chunk allocator.
+		 */
+		template<template<typename> class AllocatorT>
+		class Database<AllocatorT, ArchetypeStorage>
+		{
+		public:
+			// IDs
+
+			using EntID = _detail::EntID;
+
+			class ComID;
+
+			template<typename Com>
+			class ComInfo;
+
+			template<typename... Ts>
+			class View;
+
+			template<typename... Ts>
+			class CachedView;
+
+			class Snapshot;
+
+		private:
+			/// Size of a chunk, excluding the alignment slack.
+			static constexpr size_t chunk_bytes = 16 * 1024;
+
+			/// Alignment of every chunk.
+			static constexpr size_t chunk_align = 64;
+
+			/// Chunk memory starts with a reference count, shared with
+			/// Snapshots, and the change tick of each column, then the aligned
+			/// data. The handle itself is plain, so lists of chunks copy as a
+			/// block.
+			struct Chunk
+			{
+				unsigned char* raw;
+				unsigned char* data;
+				size_t count;
+			};
+
+			class Archetype
+			{
+				friend class Database;
+
+				vector<GUID> guids;
+				vector<TypeInfo const*> infos;
+				vector<size_t> offsets;
+				size_t capacity;
+				size_t bytes;
+
+				/// Bytes before the data: reference count and change ticks.
+				size_t header;
+
+				vector<Chunk> chunks;
+				size_t size = 0;
+
+				/// Emptied chunk kept for the next row, or a null raw pointer.
+				Chunk spare = {};
+
+				vector<pair<GUID, Archetype*>> add_edges;
+				vector<pair<GUID, Archetype*>> remove_edges;
+
+			public:
+				Archetype(vector<TypeInfo const*> types) : infos(move(types))
+				{
+					size_t row_bytes = sizeof(EntID);
+					size_t slack = 0;
+
+					for (auto info : infos)
+					{
+						guids.push_back(info->guid);
+						row_bytes += info->size;
+						slack += info->align - 1;
+					}
+
+					capacity = chunk_bytes > slack ? max<size_t>(1, (chunk_bytes - slack) / row_bytes) : 1;
+
+					size_t offset = capacity * sizeof(EntID);
+					for (auto info : infos)
+					{
+						offset = (offset + info->align - 1) / info->align * info->align;
+						offsets.push_back(offset);
+						offset += capacity * info->size;
+					}
+					bytes = offset;
+					header = sizeof(size_t) + infos.size() * sizeof(uint64_t);
+				}
+
+				int column(GUID guid) const
+				{
+					auto pos = lower_bound(begin(guids), end(guids), guid);
+					if (pos != end(guids) && *pos == guid)
+						return int(pos - begin(guids));
+					return -1;
+				}
+
+				bool has(GUID guid) const
+				{
+					return binary_search(begin(guids), end(guids), guid);
+				}
+
+				EntID* entities(Chunk const& chunk) const
+				{
+					return reinterpret_cast<EntID*>(chunk.data);
+				}
+
+				void* data(Chunk const& chunk, int col) const
+				{
+					return chunk.data + offsets[col];
+				}
+
+				void* at(Chunk const& chunk, int col, size_t row) const
+				{
+					return chunk.data + offsets[col] + row * infos[col]->size;
+				}
+
+				/// Change tick of each column.
+				uint64_t* ticks(Chunk const& chunk) const
+				{
+					return reinterpret_cast<uint64_t*>(chunk.raw + sizeof(size_t));
+				}
+			};
+
+			struct Location
+			{
+				Archetype* arch;
+				size_t chunk;
+				size_t row;
+			};
+
+			template<typename T>
+			using AllocVector = vector<T, AllocatorT<T>>;
+
+			vector<unique_ptr<Archetype>> archetypes;
+			map<vector<GUID>, Archetype*> archetype_index;
+			Archetype* root;
+
+			PagedSlotTable<Location, AllocatorT> locations;
+			Signals signals;
+
+			uint64_t change_tick = 0;
+			uint64_t structure_version = 0;
+
+		public:
+			/*! Component ID
+			 *
+			 * A handle to a type-erased component. Very lightweight.
+			 * Unlike the default storage, stays valid when other components are
+			 * added to or removed from the Entity.
+			 */
+			class ComID
+			{
+				friend class Database;
+
+				Database* db = nullptr;
+				EntID eid;
+				GUID guid = 0;
+
+			public:
+				/*! Access component data.
+				 *
+				 * The specified type must match the component's real type,
+				 * otherwise behaviour is undefined.
+				 *
+				 * @tparam Explicit component data type.
+				 * @return Reference to component data.
+				 */
+				template<typename T>
+				T& cast() const
+				{
+					auto& loc = db->locations[eid.index()];
+					int col = loc.arch->column(guid);
+					return *static_cast<T*>(loc.arch->at(db->own(*loc.arch, loc.chunk), col, loc.row));
+				}
+
+				/*! Get parent's EntID.
+				 *
+				 * @return Handle to parent Entity.
+				 */
+				EntID const& EID() const
+				{
+					return eid;
+				}
+
+				/*! Compares this ComID to another for equivalence.
+				 *
+				 * @param other The ComID to compare to this.
+				 * @return True if ComIDs are equivalent.
+				 */
+				bool operator==(ComID const& other) const
+				{
+					return db == other.db && eid == other.eid && guid == other.guid;
+				}
+
+				/*! Compares this ComID to another for ordering.
+				 *
+				 * @param other The ComID to compare to this.
+				 * @return True if this should be ordered before other.
+				 */
+				bool operator<(ComID const& other) const
+				{
+					return tie(db, eid, guid) < tie(other.db, other.eid, other.guid);
+				}
+			};
+
+			/*! Component Info
+			 *
+			 * A handle to a component of known type.
+			 * Provides direct access to the component,
+			 * as well as its ComID.
+			 *
+			 * @tparam Com Component type.
+			 */
+			template<typename Com>
+			class ComInfo
+			{
+				friend class Database;
+
+				Com* ptr = nullptr;
+				ComID cid;
+
+				ComInfo(void* p, ComID i) : ptr(static_cast<Com*>(p)), cid(i)
+				{ }
+
+			public:
+				using type = Com;
+
+				ComInfo() = default;
+
+				/*! Test for validity.
+				 *
+				 * @return True if valid.
+				 */
+				explicit operator bool() const
+				{
+					return ptr != nullptr;
+				}
+
+				/*! Get component.
+				 *
+				 * @warning
+				 * Behaviour is undefined if this ComInfo is invalid.
+				 *
+				 * @return The component.
+				 */
+				Com& data() const
+				{
+					return *ptr;
+				}
+
+				/*! Get component ID.
+				 *
+				 * @warning
+				 * Behaviour is undefined if this ComInfo is invalid.
+				 *
+				 * @return A ComID handle for this component.
+				 */
+				ComID const& id() const
+				{
+					return cid;
+				}
+			};
+
+			/*! Component Info for Tags
+			 *
+			 * A handle to a component of known type.
+			 * Provides the component's ComID.
+			 *
+			 * @tparam Com Component type.
+			 */
+			template<typename Com>
+			class ComInfo<Tag<Com>>
+			{
+				friend class Database;
+
+				bool is_valid = false;
+				ComID cid;
+
+				ComInfo(void*, ComID i) : is_valid(true), cid(i)
+				{ }
+
+			public:
+				using type = Com;
+
+				ComInfo() = default;
+
+				/*! Test for validity.
+				 *
+				 * @return True if valid.
+				 */
+				explicit operator bool() const
+				{
+					return is_valid;
+				}
+
+				/*! Get component ID.
+				 *
+				 * @warning
+				 * Behaviour is undefined if this ComInfo is invalid.
+				 *
+				 * @return A ComID handle for this component.
+				 */
+				ComID const& id() const
+				{
+					return cid;
+				}
+			};
+
+			Database() : root(find_archetype({}))
+			{ }
+
+			~Database()
+			{
+				for (auto& arch : archetypes)
+				{
+					for (auto& chunk : arch->chunks)
+						release_chunk(*arch, chunk);
+
+					if (arch->spare.raw)
+						free_chunk(*arch, arch->spare);
+				}
+			}
+
+			Database(Database const&) = delete;
+
+			Database& operator=(Database const&) = delete;
+
+			// Entity functions
+
+			/*! Creates a new Entity.
+			 *
+			 * Creates a new Entity that has no components.
+			 *
+			 * @return EntID of the new Entity.
+			 */
+			EntID create_entity()
+			{
+				EntID rv = locations.emplace();
+				locations[rv.index()] = push_row(*root, rv);
+				return rv;
+			}
+
+			/*! Creates several Entities at once.
+			 *
+			 * Creates n Entities, each with a copy of the given components.
+			 * The Entities go straight to their archetype, filling its chunks
+			 * row after row; nothing is moved.
+			 *
+			 * @param n Number of Entities to create.
+			 * @param coms Component values, of distinct types.
+			 * @return EntIDs of the new Entities.
+			 */
+			template<typename... Ts>
+			vector<EntID> create_entities(size_t n, Ts const& ... coms)
+			{
+				static_assert(ListUnique<TypeList<Ts...>>::value, "Component types must be distinct");
+
+				Archetype* arch = root;
+				(void) initializer_list<int>{(arch = add_edge(*arch, getTypeInfo<Ts>()), 0)...};
+
+				int cols[] = {arch->column(getGUID<Ts>())..., -1};
+				(void) cols;
+
+				vector<EntID> rv;
+				rv.reserve(n);
+				locations.reserve(n);
+				uint64_t tick = stamp();
+				++structure_version;
+
+				while (rv.size() < n)
+				{
+					if (arch->chunks.empty() || arch->chunks.back().count == arch->capacity)
+						arch->chunks.push_back(take_chunk(*arch));
+
+					size_t chunk_index = arch->chunks.size() - 1;
+					auto& chunk = own(*arch, chunk_index);
+					fill_n(arch->ticks(chunk), arch->infos.size(), tick);
+
+					for (size_t rows = min(arch->capacity - chunk.count, n - rv.size()); rows > 0; --rows)
+					{
+						size_t row = chunk.count;
+						int col = 0;
+						(void) initializer_list<int>{(construct(arch->at(chunk, cols[col++], row), coms), 0)...};
+
+						EntID eid = locations.emplace(Location{arch, chunk_index, row});
+						arch->entities(chunk)[row] = eid;
+						++chunk.count;
+						++arch->size;
+						rv.push_back(eid);
+					}
+				}
+
+				(void) initializer_list<int>{(signals.emit(getGUID<Ts>(), Signal::construct, rv.data(), rv.size()), 0)...};
+				return rv;
+			}
+
+			/*! Destroys an Entity.
+			 *
+			 * Destroys the given Entity and all associated components.
+			 * Does nothing if the EntID is dangling.
+			 *
+			 * @warning
+			 * All components associated with the Entity are destroyed.
+			 * This means that all references and ComIDs associated with those
+			 * components are invalidated.
+			 *
+			 * @param eid EntID of the Entity to erase.
+			 */
+			void erase_entity(EntID eid)
+			{
+				if (!valid(eid))
+					return;
+
+				auto loc = locations[eid.index()];
+
+				if (signals.observed(Signal::destroy))
+					for (auto info : loc.arch->infos)
+						signals.emit(info->guid, Signal::destroy, eid);
+
+				auto& chunk = own(*loc.arch, loc.chunk);
+
+				destroy_rows(*loc.arch, chunk, loc.row, loc.row + 1);
+				remove_row(*loc.arch, loc.chunk, loc.row);
+
+				locations.erase(eid);
+			}
+
+			/*! Test an EntID.
+			 *
+			 * @param eid EntID to test.
+			 * @return True if the EntID refers to a living Entity.
+			 */
+			bool valid(EntID eid) const
+			{
+				return locations.alive(eid);
+			}
+
+			/*! Query an Entity for a component.
+			 *
+			 * Queries the Entity for the given component type.
+			 * If found, returns a valid ComInfo object for the requested
+			 * component.
+			 * Otherwise, or if the EntID is dangling, returns an invalid ComInfo
+			 * object.
+			 *
+			 * @tparam T Explicit type of component.
+			 * @param eid Entity to query.
+			 * @return ComInfo for the requested component.
+			 */
+			template<typename T>
+			ComInfo<T> get(EntID eid) const
+			{
+				if (!locations.alive(eid))
+					return {};
+
+				auto& loc = locations[eid.index()];
+				int col = loc.arch->column(getGUID<T>());
+
+				if (col < 0)
+					return {};
+
+				// The ComInfo gives write access
+				auto& chunk = const_cast<Database*>(this)->own(*loc.arch, loc.chunk);
+
+				ComID cid;
+				cid.db = const_cast<Database*>(this);
+				cid.eid = eid;
+				cid.guid = getGUID<T>();
+				return {loc.arch->at(chunk, col, loc.row), cid};
+			}
+
+			/*! Query an Entity for multiple components.
+			 *
+			 * Returns a tuple containing results equivalent to multiple
+			 * calls to get().
+			 *
+			 * @tparam Ts Explicit component types.
+			 * @param eid Entity to query.
+			 * @return Tuple of results equivalent to get().
+			 */
+			template<typename... Ts>
+			tuple<ComInfo<Ts>...> coms(EntID eid) const
+			{
+				return make_tuple(get<Ts>(eid)...);
+			}
+
+			// Component functions
+
+			/*! Create new component.
+			 *
+			 * Creates a new component from the given value and associates it with
+			 * the given Entity.
+			 * If a component of the same type already exists, it will be
+			 * overwritten.
+			 *
+			 * @warning
+			 * The Entity is moved to another archetype. References to components
+			 * of the Entity are invalidated.
+			 *
+			 * @param eid Entity to attach new component to.
+			 * @param com Component value.
+			 * @return ComInfo for the new component.
+			 */
+			template<typename T>
+			ComInfo<T> create_component(EntID eid, T com)
+			{
+				assert(valid(eid) && "Dangling EntID");
+				GUID guid = getGUID<T>();
+				auto loc = locations[eid.index()];
+				int col = loc.arch->column(guid);
+
+				if (col >= 0)
+				{
+					auto& chunk = own(*loc.arch, loc.chunk);
+					*static_cast<T*>(loc.arch->at(chunk, col, loc.row)) = move(com);
+					loc.arch->ticks(chunk)[col] = stamp();
+					signals.emit(guid, Signal::update, eid);
+				}
+				else
+				{
+					loc = move_entity(eid, add_edge(*loc.arch, getTypeInfo<T>()));
+					col = loc.arch->column(guid);
+					::new(loc.arch->at(loc.arch->chunks[loc.chunk], col, loc.row)) T(move(com));
+					signals.emit(guid, Signal::construct, eid);
+				}
+
+				ComID cid;
+				cid.db = this;
+				cid.eid = eid;
+				cid.guid = guid;
+				return {loc.arch->at(loc.arch->chunks[loc.chunk], col, loc.row), cid};
+			}
+
+			/*! Create new component.
+			 *
+			 * Associates the given tag with the given Entity.
+			 *
+			 * @warning
+			 * The Entity is moved to another archetype. References to components
+			 * of the Entity are invalidated.
+			 *
+			 * @param eid Entity to attach new component to.
+			 * @param com Component value.
+			 * @return ComInfo for the new component.
+			 */
+			template<typename T>
+			ComInfo<Tag<T>> create_component(EntID eid, Tag<T>)
+			{
+				assert(valid(eid) && "Dangling EntID");
+				GUID guid = getGUID<Tag<T>>();
+				auto& loc = locations[eid.index()];
+
+				if (!loc.arch->has(guid))
+				{
+					move_entity(eid, add_edge(*loc.arch, getTypeInfo<Tag<T>>()));
+					signals.emit(guid, Signal::construct, eid);
+				}
+
+				ComID cid;
+				cid.db = this;
+				cid.eid = eid;
+				cid.guid = guid;
+				return {nullptr, cid};
+			}
+
+			/*! Create several components at once.
+			 *
+			 * Relocates the given values into the Entity, moving it to its final
+			 * archetype once instead of once per new component. Existing
+			 * components are overwritten, and later values win over earlier
+			 * values of the same type.
+			 *
+			 * Every value is consumed: after this call, the storage of the
+			 * pending values holds no object.
+			 *
+			 * @warning
+			 * The Entity is moved to another archetype. References to components
+			 * of the Entity are invalidated.
+			 *
+			 * @param eid Entity to attach the components to.
+			 * @param coms Pending component values.
+			 * @param count Number of pending components.
+			 */
+			void create_components(EntID eid, PendingComponent const* coms, size_t count)
+			{
+				assert(valid(eid) && "Dangling EntID");
+				auto loc = locations[eid.index()];
+				Archetype* from = loc.arch;
+				Archetype* to = from;
+
+				for (size_t i = 0; i < count; ++i)
+					if (!to->has(coms[i].info->guid))
+						to = add_edge(*to, coms[i].info);
+
+				if (to != from)
+					loc = move_entity(eid, to);
+
+				auto& chunk = own(*to, loc.chunk);
+				for (size_t i = 0; i < count; ++i)
+				{
+					auto info = coms[i].info;
+
+					bool constructed = from->has(info->guid);
+					for (size_t j = 0; j < i && !constructed; ++j)
+						constructed = coms[j].info == info;
+
+					signals.emit(info->guid, constructed ? Signal::update : Signal::construct, eid);
+
+					if (info->size == 0)
+						continue;
+
+					int col = to->column(info->guid);
+					void* dst = to->at(chunk, col, loc.row);
+					if (constructed)
+					{
+						info->destroy(dst);
+						to->ticks(chunk)[col] = stamp();
+					}
+					relocateValue(info, dst, coms[i].value);
+				}
+			}
+
+			/*! Create a component on several Entities.
+			 *
+			 * Equivalent to calling create_component() with each EntID and
+			 * the value at the same position. Consecutive Entities of the same
+			 * archetype share the transition lookup.
+			 *
+			 * @warning
+			 * The Entities are moved to another archetype. References to their
+			 * components are invalidated.
+			 *
+			 * @param eids Entities to attach the components to.
+			 * @param coms Component values, one per Entity.
+			 * @param count Number of Entities.
+			 */
+			template<typename T>
+			void create_components(EntID const* eids, T const* coms, size_t count)
+			{
+				GUID guid = getGUID<T>();
+				Archetype* from = nullptr;
+				Archetype* to = nullptr;
+				int col = -1;
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					assert(valid(eids[i]) && "Dangling EntID");
+					auto loc = locations[eids[i].index()];
+
+					if (loc.arch != from)
+					{
+						from = loc.arch;
+						to = from->has(guid) ? from : add_edge(*from, getTypeInfo<T>());
+						col = to->column(guid);
+					}
+
+					if (to == from)
+					{
+						auto& chunk = own(*to, loc.chunk);
+						assign(to->at(chunk, col, loc.row), coms[i]);
+						to->ticks(chunk)[col] = stamp();
+						signals.emit(guid, Signal::update, eids[i]);
+					}
+					else
+					{
+						loc = move_entity(eids[i], to);
+						construct(to->at(to->chunks[loc.chunk], col, loc.row), coms[i]);
+						signals.emit(guid, Signal::construct, eids[i]);
+					}
+				}
+			}
+
+			/*! Erase a component.
+			 *
+			 * Destroys the given component and disassociates it from its Entity.
+			 *
+			 * @warning
+			 * The Entity is moved to another archetype. References to components
+			 * of the Entity are invalidated.
+			 *
+			 * @param cid ComID of the component to erase.
+			 */
+			void erase_component(ComID cid)
+			{
+				auto& loc = locations[cid.eid.index()];
+
+				if (loc.arch->has(cid.guid))
+				{
+					signals.emit(cid.guid, Signal::destroy, cid.eid);
+					move_entity(cid.eid, remove_edge(*loc.arch, cid.guid));
+				}
+			}
+
+			/*! Visit the Database.
+			 *
+			 * Calls the visitor once for each Entity that matches the visitor's
+			 * parameters. Only archetypes containing every requested component
+			 * are visited, one chunk at a time.
+			 *
+			 * @warning
+			 * Creating or erasing components or Entities during a visit is
+			 * undefined behaviour. Record them in a CommandBuffer and flush it
+			 * after the visit instead.
+			 *
+			 * @param visitor Visitor to call.
+			 */
+			template<typename Visitor>
+			void visit(Visitor&& visitor)
+			{
+				visit(std::forward<Visitor>(visitor), 0);
+			}
+
+			template<typename Visitor>
+			void visit(Visitor&& visitor) const
+			{
+				const_cast<Database&>(*this).visit(std::forward<Visitor>(visitor));
+			}
+
+			/*! Visit the Database for changes.
+			 *
+			 * Equivalent to visit(), but `Changed<T>` parameters only match the
+			 * chunks where a T was created or written after the given tick.
+			 * Keep the value of tick() from the previous run to visit what
+			 * changed since then.
+			 *
+			 * The chunks visited with `T&` or `ComInfo<T>` parameters are marked
+			 * as changed.
+			 *
+			 * @param visitor Visitor to call.
+			 * @param since Change tick.
+			 */
+			template<typename Visitor>
+			void visit(Visitor&& visitor, uint64_t since)
+			{
+				using Traits = VisitorTraits<Database, Visitor>;
+				ProfileScope profile("ginseng::visit");
+				visit_impl(visitor, since, typename Traits::components{});
+			}
+
+			/*! Visit the Database in batches.
+			 *
+			 * Calls the function once per chunk holding Entities that have
+			 * every requested component, as `func(lanes..., size_t n)`. Each
+			 * lane pointer covers the n components of its type in the chunk,
+			 * as `n * Lanes<T>::count` scalars of type `Lanes<T>::type`. For
+			 * example, with two-float positions and velocities:
+			 *
+			 *     db.visit_batch<Position, Velocity const>([dt](float* p, float const* v, size_t n)
+			 *     {
+			 *         for (size_t i = 0; i < n * 2; ++i)
+			 *             p[i] += v[i] * dt;
+			 *     });
+			 *
+			 * Components given as `T const` are read; the others count as
+			 * written, for change tracking.
+			 *
+			 * @warning
+			 * Same restrictions as visit().
+			 *
+			 * @param func Function to call.
+			 * @tparam Ts Component types, each with a Lanes specialization.
+			 */
+			template<typename... Ts, typename Func>
+			void visit_batch(Func&& func)
+			{
+				static_assert(sizeof...(Ts) > 0, "Batch visits need at least one component");
+				static_assert(ListUnique<TypeList<remove_const_t<Ts>...>>::value, "Component types must be distinct");
+
+				bool checked[] = {LaneCheck<Ts>::value...};
+				(void) checked;
+				ProfileScope profile("ginseng::visit_batch");
+
+				auto filter = make_filter(TypeList<remove_const_t<Ts>...>{});
+				filter.add_writes(LaneWrites<Ts...>{});
+				uint64_t tick = filter.num_written ? stamp() : 0;
+
+				for (auto& arch : archetypes)
+				{
+					if (arch->size == 0 || !filter.matches(*arch))
+						continue;
+
+					for (size_t i = 0; i < arch->chunks.size(); ++i)
+					{
+						auto& chunk = filter.num_written ? own(*arch, i) : arch->chunks[i];
+						func(static_cast<LaneType<Ts>*>(arch->data(chunk, arch->column(getGUID<remove_const_t<Ts>>())))..., chunk.count);
+						filter.mark(*arch, chunk, tick);
+					}
+				}
+			}
+
+			/*! Visit the Database in parallel.
+			 *
+			 * Equivalent to visit(), but the chunks of the matching archetypes
+			 * are visited concurrently by the given executor, in batches of about
+			 * grain Entities. The executor must provide
+			 * `parallel_for(count, grain, f)`, calling `f(begin, end)` over
+			 * `[0, count)`.
+			 *
+			 * Each Entity is visited by exactly one thread, so writing to the
+			 * visited components is safe. The visitor is shared by every
+			 * thread: its call operator must be const, and it must not take
+			 * ComInfo parameters.
+			 *
+			 * @param executor Executor running the batches.
+			 * @param visitor Visitor to call.
+			 * @param grain Approximate number of Entities per batch.
+			 * @param since Change tick, as for visit().
+			 */
+			template<typename Executor, typename Visitor>
+			void parallel_visit(Executor& executor, Visitor&& visitor, size_t grain = 1024, uint64_t since = 0)
+			{
+				using Traits = VisitorTraits<Database, Visitor>;
+				static_assert(ParallelVisitCheck<Database, Visitor>::value, "");
+				ProfileScope profile("ginseng::parallel_visit");
+
+				parallel_visit_impl(executor, visitor, grain, since, typename Traits::components{});
+			}
+
+			// query
+
+			/*! Create a View of the Database.
+			 *
+			 * Returns a lazy range over the Entities matching the given
+			 * parameters, which follow the same rules as visitor parameters.
+			 * Usable with range-for and the standard algorithms.
+			 *
+			 * `Changed<T>` parameters only match the chunks changed after the
+			 * given tick. Writes through a View are not tracked; use touch().
+			 *
+			 * @tparam Ts View parameters.
+			 * @param since Change tick.
+			 * @return View of the matching Entities.
+			 */
+			template<typename... Ts>
+			View<Ts...> view(uint64_t since = 0)
+			{
+				auto filter = make_filter(TypeList<decay_t<Ts>...>{});
+				filter.since = since;
+				filter.add_writes(typename AccessImpl<Database, TypeList<Ts...>>::writes{});
+				return {this, filter};
+			}
+
+			/*! Create a cached View of the Database.
+			 *
+			 * Like view(), but the result can be kept across frames and only
+			 * tests new archetypes when iterated again.
+			 *
+			 * @tparam Ts View parameters.
+			 * @return Cached View of the matching Entities.
+			 */
+			template<typename... Ts>
+			CachedView<Ts...> cached_view()
+			{
+				auto filter = make_filter(TypeList<decay_t<Ts>...>{});
+				filter.add_writes(typename AccessImpl<Database, TypeList<Ts...>>::writes{});
+				return {this, filter};
+			}
+
+			/*! Query the Database.
+			 *
+			 * Queries the Database for Entities that match the given template parameters.
+			 *
+			 * Returns a `std::vector<std::tuple<Ts...>>` where each element is a tuple of values filled by calling
+			 * `visit([](Ts...){})` and forwarding the visitor's parameters to each tuple.
+			 * Prefer view(), which does not allocate.
+			 *
+			 * @tparam Ts Query parameters.
+			 * @return Query results.
+			 */
+			template<typename... Ts>
+			std::vector<std::tuple<Ts...>> query()
+			{
+				auto v = view<Ts...>();
+				return std::vector<std::tuple<Ts...>>(v.begin(), v.end());
+			}
+
+			// status functions
+			size_t size() const
+			{
+				return locations.size();
+			}
+
+			/*! Number of archetypes.
+			 *
+			 * Includes the empty archetype, which holds Entities without
+			 * components.
+			 *
+			 * @return Number of archetypes.
+			 */
+			size_t archetype_count() const
+			{
+				return archetypes.size();
+			}
+
+			/*! Release unused memory.
+			 *
+			 * Rows never leave holes: erasing moves the last row of the
+			 * archetype into the freed row. An archetype keeps its last
+			 * emptied chunk, so an Entity passing through it does not
+			 * allocate; compact() frees those chunks, along with the spare
+			 * capacity of the chunk lists.
+			 */
+			void compact()
+			{
+				for (auto& arch : archetypes)
+				{
+					arch->chunks.shrink_to_fit();
+
+					if (arch->spare.raw)
+						free_chunk(*arch, arch->spare);
+				}
+			}
+
+			/*! Current change tick.
+			 *
+			 * Every change is stamped with a tick greater than the current one.
+			 *
+			 * @return Current change tick.
+			 */
+			uint64_t tick() const
+			{
+				return change_tick;
+			}
+
+			/*! Structure version.
+			 *
+			 * Changes whenever Entities or components are created or erased,
+			 * or components move in memory, including when a chunk shared
+			 * with a Snapshot is copied. While it stays the same, pointers to
+			 * components remain valid, and so does the absence of a component.
+			 *
+			 * @return Structure version.
+			 */
+			uint64_t version() const
+			{
+				return structure_version;
+			}
+
+			/*! Mark a component as changed.
+			 *
+			 * For writes the Database cannot see, such as writes through get()
+			 * or a View. Marks the whole chunk of the Entity.
+			 *
+			 * @tparam T Explicit type of component.
+			 * @param eid Entity owning the component.
+			 */
+			template<typename T>
+			void touch(EntID eid)
+			{
+				if (!locations.alive(eid))
+					return;
+
+				auto& loc = locations[eid.index()];
+				int col = loc.arch->column(getGUID<T>());
+
+				if (col >= 0)
+				{
+					loc.arch->ticks(own(*loc.arch, loc.chunk))[col] = stamp();
+					signals.emit(getGUID<T>(), Signal::update, eid);
+				}
+			}
+
+			// Signals
+
+			/*! Listen to component creation.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities that gained a T since the previous dispatch().
+			 *
+			 * @tparam T Component type, which may be a Tag.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_construct(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::construct, std::forward<Func>(func));
+			}
+
+			/*! Listen to component updates.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities whose T was overwritten by create_component() or
+			 * marked by touch() since the previous dispatch(). Writes through
+			 * visitors, Views or get() are not signaled.
+			 *
+			 * @tparam T Component type.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_update(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::update, std::forward<Func>(func));
+			}
+
+			/*! Listen to component destruction.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities that lost their T, or were erased, since the
+			 * previous dispatch(). Erased Entities are no longer valid by then.
+			 *
+			 * @tparam T Component type, which may be a Tag.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_destroy(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::destroy, std::forward<Func>(func));
+			}
+
+			/*! Remove a listener.
+			 *
+			 * @param sid ID returned when connecting the listener.
+			 */
+			void disconnect(SignalID sid)
+			{
+				signals.disconnect(sid);
+			}
+
+			/*! Deliver the queued component events.
+			 *
+			 * The sync point of the signals: each listener is called once per
+			 * dispatch at most, with every event of its type and kind since the
+			 * previous dispatch. An Entity appears once per event, so it may
+			 * appear several times, or be gone already.
+			 *
+			 * Listeners may change the Database; the events they cause are
+			 * delivered by the next dispatch.
+			 */
+			void dispatch()
+			{
+				signals.dispatch();
+			}
+
+			// Snapshots
+
+			/*! Capture the Database.
+			 *
+			 * The Snapshot shares every chunk with the Database instead of
+			 * copying it. A chunk is copied the first time it is written
+			 * afterwards, whether by the Database or by restoring.
+			 *
+			 * @warning
+			 * Every component type must be copy constructible.
+			 * The Snapshot must not outlive the Database.
+			 *
+			 * @return Snapshot of the Database.
+			 */
+			Snapshot snapshot()
+			{
+				Snapshot rv;
+				rv.db = this;
+
+				// Chunks become shared: writing through old pointers would change the Snapshot
+				++structure_version;
+				rv.locations = locations;
+				rv.tick = change_tick;
+
+				for (auto& arch : archetypes)
+				{
+					if (arch->chunks.empty())
+						continue;
+
+					for (auto info : arch->infos)
+						assert((info->size == 0 || info->copy) && "Snapshot of a component that is not copy constructible");
+
+					for (auto& chunk : arch->chunks)
+						++refs(chunk);
+
+					rv.archetypes.push_back({arch.get(), arch->chunks, arch->size});
+				}
+
+				return rv;
+			}
+
+			/*! Restore a Snapshot.
+			 *
+			 * Brings every Entity and component back to their state when the
+			 * Snapshot was taken. The chunks are shared again; the Snapshot
+			 * stays valid and can be restored again.
+			 *
+			 * Every restored chunk counts as changed. No signal is emitted, and
+			 * the events queued since the Snapshot are dropped.
+			 *
+			 * @warning
+			 * EntIDs, ComIDs, references and Views are invalidated. Entities
+			 * created after the Snapshot are erased.
+			 *
+			 * @param snap Snapshot of this Database.
+			 */
+			void restore(Snapshot const& snap)
+			{
+				assert(snap.db == this && "Snapshot of another Database");
+
+				for (auto& arch : archetypes)
+				{
+					for (auto& chunk : arch->chunks)
+						release_chunk(*arch, chunk);
+
+					arch->chunks.clear();
+					arch->size = 0;
+				}
+
+				uint64_t tick = stamp();
+
+				for (auto& state : snap.archetypes)
+				{
+					state.arch->chunks = state.chunks;
+					state.arch->size = state.size;
+
+					// Ticks are not part of the captured state: marking the shared chunks is harmless
+					for (auto& chunk : state.arch->chunks)
+					{
+						++refs(chunk);
+						fill_n(state.arch->ticks(chunk), state.arch->infos.size(), tick);
+					}
+				}
+
+				locations = snap.locations;
+				signals.clear();
+				++structure_version;
+			}
+
+		private:
+			uint64_t stamp()
+			{
+				return ++change_tick;
+			}
+
+			// Archetypes
+
+			Archetype* find_archetype(vector<TypeInfo const*> infos)
+			{
+				vector<GUID> guids;
+				for (auto info : infos)
+					guids.push_back(info->guid);
+
+				auto pos = archetype_index.find(guids);
+				if (pos != end(archetype_index))
+					return pos->second;
+
+				archetypes.emplace_back(new Archetype(move(infos)));
+				auto arch = archetypes.back().get();
+				archetype_index.emplace(move(guids), arch);
+				return arch;
+			}
+
+			Archetype* add_edge(Archetype& from, TypeInfo const* info)
+			{
+				for (auto& edge : from.add_edges)
+					if (edge.first == info->guid)
+						return edge.second;
+
+				auto infos = from.infos;
+				auto pos = lower_bound(begin(infos), end(infos), info, [](TypeInfo const* a, TypeInfo const* b)
+				{
+					return a->guid < b->guid;
+				});
+				infos.insert(pos, info);
+
+				auto to = find_archetype(move(infos));
+				from.add_edges.emplace_back(info->guid, to);
+				to->remove_edges.emplace_back(info->guid, &from);
+				return to;
+			}
+
+			Archetype* remove_edge(Archetype& from, GUID guid)
+			{
+				for (auto& edge : from.remove_edges)
+					if (edge.first == guid)
+						return edge.second;
+
+				auto infos = from.infos;
+				infos.erase(begin(infos) + from.column(guid));
+
+				auto to = find_archetype(move(infos));
+				from.remove_edges.emplace_back(guid, to);
+				to->add_edges.emplace_back(guid, &from);
+				return to;
+			}
+
+			// Chunks
+
+			Chunk alloc_chunk(Archetype const& arch)
+			{
+				AllocatorT<unsigned char> alloc;
+
+				Chunk chunk;
+				chunk.raw = alloc.allocate(arch.bytes + chunk_align + arch.header);
+				chunk.data = chunk.raw + arch.header;
+				chunk.data += (chunk_align - reinterpret_cast<uintptr_t>(chunk.data) % chunk_align) % chunk_align;
+				chunk.count = 0;
+				::new(chunk.raw) size_t(1);
+				fill_n(arch.ticks(chunk), arch.infos.size(), 0);
+				return chunk;
+			}
+
+			void free_chunk(Archetype const& arch, Chunk& chunk)
+			{
+				AllocatorT<unsigned char> alloc;
+				alloc.deallocate(chunk.raw, arch.bytes + chunk_align + arch.header);
+				chunk.raw = chunk.data = nullptr;
+			}
+
+			/// A new chunk for the archetype, its spare one if it has one.
+			Chunk take_chunk(Archetype& arch)
+			{
+				if (!arch.spare.raw)
+					return alloc_chunk(arch);
+
+				Chunk chunk = arch.spare;
+				arch.spare.raw = arch.spare.data = nullptr;
+				return chunk;
+			}
+
+			/// Keeps an owned, emptied chunk as the spare of the archetype, or frees it.
+			void retire_chunk(Archetype& arch, Chunk& chunk)
+			{
+				if (arch.spare.raw)
+					free_chunk(arch, chunk);
+				else
+					arch.spare = chunk;
+			}
+
+			static size_t& refs(Chunk const& chunk)
+			{
+				return *reinterpret_cast<size_t*>(chunk.raw);
+			}
+
+			/// Drops a reference to the chunk memory, destroying it with the last one.
+			void release_chunk(Archetype& arch, Chunk& chunk)
+			{
+				if (--refs(chunk) == 0)
+				{
+					destroy_rows(arch, chunk, 0, chunk.count);
+					free_chunk(arch, chunk);
+				}
+			}
+
+			/// Gives the chunk its own memory, if it is shared with a Snapshot.
+			/// Must be called before writing to the chunk.
+			Chunk& own(Archetype& arch, size_t chunk_index)
+			{
+				auto& chunk = arch.chunks[chunk_index];
+
+				if (refs(chunk) != 1)
+				{
+					Chunk copy = take_chunk(arch);
+					memcpy(arch.ticks(copy), arch.ticks(chunk), arch.infos.size() * sizeof(uint64_t));
+					memcpy(arch.entities(copy), arch.entities(chunk), chunk.count * sizeof(EntID));
+
+					for (size_t col = 0; col < arch.infos.size(); ++col)
+					{
+						auto info = arch.infos[col];
+						if (info->size == 0)
+							continue;
+
+						for (size_t row = 0; row < chunk.count; ++row)
+							info->copy(arch.at(copy, int(col), row), arch.at(chunk, int(col), row));
+					}
+
+					--refs(chunk);
+					chunk.raw = copy.raw;
+					chunk.data = copy.data;
+					++structure_version;
+				}
+
+				return chunk;
+			}
+
+			void destroy_rows(Archetype& arch, Chunk& chunk, size_t first, size_t last)
+			{
+				for (size_t col = 0; col < arch.infos.size(); ++col)
+				{
+					auto info = arch.infos[col];
+					if (info->size == 0)
+						continue;
+
+					for (size_t row = first; row < last; ++row)
+						info->destroy(arch.at(chunk, int(col), row));
+				}
+			}
+
+			template<typename T>
+			static void construct(void* ptr, T const& com)
+			{
+				::new(ptr) T(com);
+			}
+
+			template<typename T>
+			static void construct(void*, Tag<T> const&)
+			{ }
+
+			template<typename T>
+			static void assign(void* ptr, T const& com)
+			{
+				*static_cast<T*>(ptr) = com;
+			}
+
+			template<typename T>
+			static void assign(void*, Tag<T> const&)
+			{ }
+
+			// Rows
+
+			Location push_row(Archetype& arch, EntID eid)
+			{
+				if (arch.chunks.empty() || arch.chunks.back().count == arch.capacity)
+					arch.chunks.push_back(take_chunk(arch));
+
+				auto& chunk = own(arch, arch.chunks.size() - 1);
+				arch.entities(chunk)[chunk.count] = eid;
+				++arch.size;
+				++structure_version;
+
+				// The new row holds components changed at an unknown tick
+				fill_n(arch.ticks(chunk), arch.infos.size(), stamp());
+
+				return {&arch, arch.chunks.size() - 1, chunk.count++};
+			}
+
+			/// Fills the given row with the last row of the archetype.
+			/// Components of the given row must already be destroyed or relocated.
+			void remove_row(Archetype& arch, size_t chunk_index, size_t row)
+			{
+				auto& chunk = own(arch, chunk_index);
+				auto& last = own(arch, arch.chunks.size() - 1);
+				size_t last_row = last.count - 1;
+				++structure_version;
+
+				if (&chunk != &last || row != last_row)
+				{
+					for (size_t col = 0; col < arch.infos.size(); ++col)
+					{
+						auto info = arch.infos[col];
+						if (info->size != 0)
+							relocateValue(info, arch.at(chunk, int(col), row), arch.at(last, int(col), last_row));
+
+						arch.ticks(chunk)[col] = max(arch.ticks(chunk)[col], arch.ticks(last)[col]);
+					}
+
+					EntID moved = arch.entities(last)[last_row];
+					arch.entities(chunk)[row] = moved;
+					locations[moved.index()].chunk = chunk_index;
+					locations[moved.index()].row = row;
+				}
+
+				--arch.size;
+				if (--last.count == 0)
+				{
+					retire_chunk(arch, last);
+					arch.chunks.pop_back();
+				}
+			}
+
+			/// Moves an Entity to another archetype.
+			/// Components missing from the destination are destroyed.
+			/// Components missing from the source are left unconstructed.
+			Location move_entity(EntID eid, Archetype* to)
+			{
+				auto from = locations[eid.index()];
+				auto dst = push_row(*to, eid);
+
+				auto& src_chunk = own(*from.arch, from.chunk);
+				auto& dst_chunk = to->chunks[dst.chunk];
+
+				size_t i = 0, j = 0;
+				while (i < from.arch->infos.size())
+				{
+					auto info = from.arch->infos[i];
+
+					if (j < to->infos.size() && to->infos[j]->guid < info->guid)
+					{
+						++j;
+						continue;
+					}
+
+					if (info->size != 0)
+					{
+						void* src = from.arch->at(src_chunk, int(i), from.row);
+
+						if (j < to->infos.size() && to->infos[j]->guid == info->guid)
+							relocateValue(info, to->at(dst_chunk, int(j), dst.row), src);
+						else
+							info->destroy(src);
+					}
+
+					++i;
+				}
+
+				remove_row(*from.arch, from.chunk, from.row);
+				locations[eid.index()] = dst;
+				return dst;
+			}
+
+			// Visit
+
+			struct Filter
+			{
+				static constexpr size_t max_guids = 32;
+
+				array<GUID, max_guids> required;
+				array<GUID, max_guids> excluded;
+				array<GUID, max_guids> changed;
+				array<GUID, max_guids> written;
+				size_t num_required = 0;
+				size_t num_excluded = 0;
+				size_t num_changed = 0;
+				size_t num_written = 0;
+				uint64_t since = 0;
+
+				template<typename Com>
+				int add()
+				{
+					using Traits = ComponentTraits<Database, Com>;
+					helper<Traits>(typename Traits::tag{});
+					return 0;
+				}
+
+				template<typename Traits>
+				void helper(ComponentTags::normal)
+				{
+					required[num_required++] = getGUID<typename Traits::com>();
+				}
+
+				template<typename Traits>
+				void helper(ComponentTags::info)
+				{
+					required[num_required++] = getGUID<typename Traits::com>();
+				}
+
+				template<typename Traits>
+				void helper(ComponentTags::tagged)
+				{
+					required[num_required++] = getGUID<typename Traits::com>();
+				}
+
+				template<typename Traits>
+				void helper(ComponentTags::inverted)
+				{
+					excluded[num_excluded++] = getGUID<typename Traits::com>();
+				}
+
+				template<typename Traits>
+				void helper(ComponentTags::changed)
+				{
+					required[num_required++] = getGUID<typename Traits::com>();
+					changed[num_changed++] = getGUID<typename Traits::com>();
+				}
+
+				template<typename Traits>
+				void helper(ComponentTags::eid)
+				{ }
+
+				template<typename... Ws>
+				void add_writes(TypeList<Ws...>)
+				{
+					(void) initializer_list<int>{(written[num_written++] = getGUID<Ws>(), 0)...};
+				}
+
+				/// True if every Changed<> component of the chunk was written
+				/// after since.
+				bool changed_in(Archetype const& arch, Chunk const& chunk) const
+				{
+					for (size_t i = 0; i < num_changed; ++i)
+						if (arch.ticks(chunk)[arch.column(changed[i])] <= since)
+							return false;
+
+					return true;
+				}
+
+				/// Marks the written components of the chunk.
+				void mark(Archetype const& arch, Chunk& chunk, uint64_t tick) const
+				{
+					for (size_t i = 0; i < num_written; ++i)
+						arch.ticks(chunk)[arch.column(written[i])] = tick;
+				}
+
+				bool matches(Archetype const& arch) const
+				{
+					for (size_t i = 0; i < num_required; ++i)
+						if (!arch.has(required[i]))
+							return false;
+
+					for (size_t i = 0; i < num_excluded; ++i)
+						if (arch.has(excluded[i]))
+							return false;
+
+					return true;
+				}
+			};
+
+			template<typename Com, typename TagT = typename ComponentTraits<Database, Com>::tag>
+			class Fetch;
+
+			template<typename Com>
+			class Fetch<Com, ComponentTags::normal>
+			{
+				Com* base = nullptr;
+
+			public:
+				Fetch() = default;
+
+				Fetch(Database&, Archetype& arch, Chunk& chunk) :
+						base(static_cast<Com*>(arch.data(chunk, arch.column(getGUID<Com>()))))
+				{ }
+
+				Com& get(size_t row) const
+				{
+					return base[row];
+				}
+			};
+
+			template<typename Com>
+			class Fetch<Com, ComponentTags::tagged>
+			{
+			public:
+				Fetch() = default;
+
+				Fetch(Database&, Archetype&, Chunk&)
+				{ }
+
+				Com get(size_t) const
+				{
+					return {};
+				}
+			};
+
+			template<typename Com>
+			class Fetch<Com, ComponentTags::inverted>
+			{
+				using Traits = ComponentTraits<Database, Com>;
+
+			public:
+				Fetch() = default;
+
+				Fetch(Database&, Archetype&, Chunk&)
+				{ }
+
+				Not<typename Traits::com> get(size_t) const
+				{
+					return {};
+				}
+			};
+
+			template<typename Com>
+			class Fetch<Com, ComponentTags::changed>
+			{
+				using Traits = ComponentTraits<Database, Com>;
+
+			public:
+				Fetch() = default;
+
+				Fetch(Database&, Archetype&, Chunk&)
+				{ }
+
+				Changed<typename Traits::com> get(size_t) const
+				{
+					return {};
+				}
+			};
+
+			template<typename Com>
+			class Fetch<Com, ComponentTags::info>
+			{
+				using Traits = ComponentTraits<Database, Com>;
+
+				Database* db = nullptr;
+				EntID* entities = nullptr;
+				unsigned char* base = nullptr;
+				size_t stride = 0;
+
+			public:
+				Fetch() = default;
+
+				Fetch(Database& d, Archetype& arch, Chunk& chunk) : db(&d), entities(arch.entities(chunk))
+				{
+					int col = arch.column(getGUID<typename Traits::com>());
+					base = static_cast<unsigned char*>(arch.data(chunk, col));
+					stride = arch.infos[col]->size;
+				}
+
+				Com get(size_t row) const
+				{
+					ComID cid;
+					cid.db = db;
+					cid.eid = entities[row];
+					cid.guid = getGUID<typename Traits::com>();
+					return {base + row * stride, cid};
+				}
+			};
+
+			template<typename Com>
+			class Fetch<Com, ComponentTags::eid>
+			{
+				EntID* entities = nullptr;
+
+			public:
+				Fetch() = default;
+
+				Fetch(Database&, Archetype& arch, Chunk& chunk) : entities(arch.entities(chunk))
+				{ }
+
+				EntID get(size_t row) const
+				{
+					return entities[row];
+				}
+			};
+
+			template<typename... Coms>
+			static Filter make_filter(TypeList<Coms...>)
+			{
+				static_assert(sizeof...(Coms) <= Filter::max_guids, "Too many visitor parameters");
+
+				Filter filter;
+				int expand[] = {0, filter.template add<Coms>()...};
+				(void) expand;
+				return filter;
+			}
+
+			template<typename Visitor, typename... Coms>
+			Filter make_visit_filter(uint64_t since, TypeList<Coms...> coms)
+			{
+				auto filter = make_filter(coms);
+				filter.since = since;
+				filter.add_writes(typename VisitorAccess<Database, Visitor>::writes{});
+				return filter;
+			}
+
+			template<typename Visitor, typename... Coms>
+			void visit_impl(Visitor& visitor, uint64_t since, TypeList<Coms...> coms)
+			{
+				auto filter = make_visit_filter<Visitor>(since, coms);
+				uint64_t tick = filter.num_written ? stamp() : 0;
+
+				for (auto& arch : archetypes)
+				{
+					if (arch->size == 0 || !filter.matches(*arch))
+						continue;
+
+					for (auto& chunk : arch->chunks)
+					{
+						if (!filter.changed_in(*arch, chunk))
+							continue;
+
+						if (filter.num_written)
+							own(*arch, size_t(&chunk - arch->chunks.data()));
+
+						visit_chunk(visitor, *arch, chunk, index_sequence_for<Coms...>{}, coms);
+						filter.mark(*arch, chunk, tick);
+					}
+				}
+			}
+
+			template<typename Executor, typename Visitor, typename... Coms>
+			void parallel_visit_impl(Executor& executor, Visitor& visitor, size_t grain, uint64_t since, TypeList<Coms...> coms)
+			{
+				auto filter = make_visit_filter<Visitor>(since, coms);
+				uint64_t tick = filter.num_written ? stamp() : 0;
+
+				vector<pair<Archetype*, Chunk*>> work;
+				size_t rows = 0;
+
+				// Chunks are marked and owned here, so workers never write
+				// change ticks or reference counts
+				for (auto& arch : archetypes)
+				{
+					if (arch->size == 0 || !filter.matches(*arch))
+						continue;
+
+					for (auto& chunk : arch->chunks)
+					{
+						if (!filter.changed_in(*arch, chunk))
+							continue;
+
+						if (filter.num_written)
+							own(*arch, size_t(&chunk - arch->chunks.data()));
+
+						work.emplace_back(arch.get(), &chunk);
+						filter.mark(*arch, chunk, tick);
+						rows += chunk.count;
+					}
+				}
+
+				if (work.empty())
+					return;
+
+				// grain is given in Entities, but work is split per chunk
+				size_t chunk_grain = max<size_t>(1, grain * work.size() / rows);
+
+				executor.parallel_for(work.size(), chunk_grain, [&](size_t first, size_t last)
+				{
+					for (size_t i = first; i < last; ++i)
+						visit_chunk(visitor, *work[i].first, *work[i].second, index_sequence_for<Coms...>{}, coms);
+				});
+			}
+
+			template<typename Visitor, size_t... Is, typename... Coms>
+			void visit_chunk(Visitor& visitor, Archetype& arch, Chunk& chunk, index_sequence<Is...>, TypeList<Coms...>)
+			{
+				tuple<Fetch<Coms>...> fetch{Fetch<Coms>(*this, arch, chunk)...};
+				(void) fetch;
+
+				for (size_t row = 0, e = chunk.count; row < e; ++row)
+					visitor(std::get<Is>(fetch).get(row)...);
+			}
+
+		public:
+			// Views
+
+			/*! View
+			 *
+			 * A lazy range over the Entities matching a set of parameters,
+			 * following the same rules as visitor parameters. Each element is a
+			 * `std::tuple<Ts...>` of references (or values) to the components.
+			 *
+			 * Iteration walks the chunks of the matching archetypes and does not
+			 * allocate. A View is invalidated by creating or erasing components
+			 * or Entities.
+			 *
+			 * @tparam Ts View parameters.
+			 */
+			template<typename... Ts>
+			class View
+			{
+				friend class Database;
+
+				template<typename...>
+				friend class CachedView;
+
+				Database* db = nullptr;
+				Filter filter;
+
+				/// Archetypes to walk, or nullptr to filter every archetype.
+				vector<Archetype*> const* list = nullptr;
+
+				View(Database* d, Filter const& f) : db(d), filter(f)
+				{ }
+
+				size_t archetype_count() const
+				{
+					return list ? list->size() : db->archetypes.size();
+				}
+
+				Archetype* archetype(size_t i) const
+				{
+					return list ? (*list)[i] : db->archetypes[i].get();
+				}
+
+			public:
+				View() = default;
+
+				class iterator
+				{
+					friend class View;
+
+					View const* view = nullptr;
+					size_t arch = 0;
+					size_t chunk = 0;
+					size_t row = 0;
+					size_t rows = 0;
+					tuple<Fetch<decay_t<Ts>>...> fetch;
+
+					iterator(View const* v, size_t a) : view(v), arch(a)
+					{
+						seek();
+					}
+
+					/// Moves to the first row of the next non-empty chunk,
+					/// starting at the current one.
+					void seek()
+					{
+						for (; arch < view->archetype_count(); ++arch, chunk = 0)
+						{
+							Archetype* a = view->archetype(arch);
+							if (a->size == 0 || (!view->list && !view->filter.matches(*a)))
+								continue;
+
+							for (; chunk < a->chunks.size(); ++chunk)
+							{
+								Chunk& c = a->chunks[chunk];
+								if (!view->filter.changed_in(*a, c))
+									continue;
+
+								if (view->filter.num_written)
+									view->db->own(*a, chunk);
+
+								fetch = tuple<Fetch<decay_t<Ts>>...>(Fetch<decay_t<Ts>>(*view->db, *a, c)...);
+								row = 0;
+								rows = c.count;
+								return;
+							}
+						}
+
+						chunk = 0;
+						row = 0;
+					}
+
+					template<size_t... Is>
+					tuple<Ts...> get(index_sequence<Is...>) const
+					{
+						return tuple<Ts...>(std::get<Is>(fetch).get(row)...);
+					}
+
+				public:
+					using iterator_category = input_iterator_tag;
+					using value_type = tuple<Ts...>;
+					using difference_type = ptrdiff_t;
+					using pointer = void;
+					using reference = tuple<Ts...>;
+
+					iterator() = default;
+
+					reference operator*() const
+					{
+						return get(index_sequence_for<Ts...>{});
+					}
+
+					iterator& operator++()
+					{
+						if (++row == rows)
+						{
+							++chunk;
+							seek();
+						}
+						return *this;
+					}
+
+					iterator operator++(int)
+					{
+						iterator rv = *this;
+						++*this;
+						return rv;
+					}
+
+					bool operator==(iterator const& other) const
+					{
+						return arch == other.arch && chunk == other.chunk && row == other.row;
+					}
+
+					bool operator!=(iterator const& other) const
+					{
+						return !(*this == other);
+					}
+				};
+
+				iterator begin() const
+				{
+					return {this, 0};
+				}
+
+				iterator end() const
+				{
+					return {this, archetype_count()};
+				}
+			};
+
+			/*! Cached View
+			 *
+			 * A View that remembers its matching archetypes, so it can be kept
+			 * across frames. Archetypes are never destroyed, so the match set is
+			 * updated incrementally: each begin() only tests the archetypes
+			 * created since the last one.
+			 *
+			 * The Database must outlive the CachedView.
+			 *
+			 * @tparam Ts View parameters.
+			 */
+			template<typename... Ts>
+			class CachedView
+			{
+				friend class Database;
+
+				View<Ts...> current;
+				vector<Archetype*> matches;
+				size_t scanned = 0;
+
+				CachedView(Database* d, Filter const& f) : current(d, f)
+				{ }
+
+			public:
+				using iterator = typename View<Ts...>::iterator;
+
+				CachedView() = default;
+
+				iterator begin()
+				{
+					auto& archetypes = current.db->archetypes;
+					for (; scanned < archetypes.size(); ++scanned)
+						if (current.filter.matches(*archetypes[scanned]))
+							matches.push_back(archetypes[scanned].get());
+
+					current.list = &matches;
+					return current.begin();
+				}
+
+				iterator end()
+				{
+					current.list = &matches;
+					return current.end();
+				}
+			};
+
+			// Snapshots
+
+			/*! Snapshot
+			 *
+			 * The state of a Database at some point, sharing its chunks with
+			 * the Database and with other Snapshots. Move-only; releasing a
+			 * Snapshot frees the chunks no one else uses.
+			 *
+			 * Meant to be taken every frame and kept in a ring, for rollback
+			 * and replay.
+			 */
+			class Snapshot
+			{
+				friend class Database;
+
+				struct ArchetypeState
+				{
+					Archetype* arch;
+					vector<Chunk> chunks;
+					size_t size;
+				};
+
+				Database* db = nullptr;
+				vector<ArchetypeState> archetypes;
+				PagedSlotTable<Location, AllocatorT> locations;
+				uint64_t tick = 0;
+
+			public:
+				Snapshot() = default;
+
+				Snapshot(Snapshot&& other) noexcept :
+						db(other.db),
+						archetypes(move(other.archetypes)),
+						locations(move(other.locations)),
+						tick(other.tick)
+				{
+					other.db = nullptr;
+				}
+
+				Snapshot& operator=(Snapshot&& other) noexcept
+				{
+					if (this != &other)
+					{
+						reset();
+						db = other.db;
+						archetypes = move(other.archetypes);
+						locations = move(other.locations);
+						tick = other.tick;
+						other.db = nullptr;
+					}
+					return *this;
+				}
+
+				Snapshot(Snapshot const&) = delete;
+
+				Snapshot& operator=(Snapshot const&) = delete;
+
+				~Snapshot()
+				{
+					reset();
+				}
+
+				/*! Test for validity.
+				 *
+				 * @return True if this Snapshot holds a state.
+				 */
+				explicit operator bool() const
+				{
+					return db != nullptr;
+				}
+
+				/*! Change tick of the Database when the Snapshot was taken.
+				 *
+				 * @return Change tick.
+				 */
+				uint64_t taken_at() const
+				{
+					return tick;
+				}
+
+				/*! Releases the state held by this Snapshot.
+				 */
+				void reset()
+				{
+					if (db)
+						for (auto& state : archetypes)
+							for (auto& chunk : state.chunks)
+								db->release_chunk(*state.arch, chunk);
+
+					archetypes.clear();
+					db = nullptr;
+				}
+			};
+		};
+
+	} // namespace _detail
+} // namespace ginseng
@@ -0,0 +1,387 @@
+#pragma once
+
+#include "../ginseng.hpp"
+
+#include <cstdint>
+#include <new>
+
+namespace ginseng
+{
+	namespace _detail
+	{
+		template<typename DB, typename = void>
+		struct HasCreateComponents : false_type
+		{ };
+
+		template<typename DB>
+		struct HasCreateComponents<DB, decltype(declval<DB&>().create_components(EntID{}, nullptr, size_t(0)))> : true_type
+		{ };
+
+		/*! Command Buffer
+		 *
+		 * Records structural changes to a Database (creating and erasing
+		 * Entities and components) and applies them later, in one pass, at a
+		 * point where no visit is running.
+		 *
+		 * Recording never touches the Database. A buffer is meant to be
+		 * owned by a single thread, so appending takes no lock; parallel
+		 * systems keep one buffer per thread and flush them one after the
+		 * other.
+		 *
+		 * On flush, commands are sorted by Entity (keeping their recorded
+		 * order per Entity), so that the components added to an Entity are
+		 * inserted together. Storages providing `create_components()` insert
+		 * them with a single archetype move.
+		 *
+		 * Component values are kept in memory blocks reused from one flush to
+		 * the next, so a warm buffer does not allocate.
+		 *
+		 * @tparam DB Database type.
+		 */
+		template<typename DB>
+		class CommandBuffer
+		{
+			enum class Kind : uint8_t
+			{
+				create_component,
+				erase_component,
+				erase_entity,
+			};
+
+			struct Command
+			{
+				EntID eid;
+				Kind kind;
+				PendingComponent com;
+
+				/// Applies a create_component or erase_component command.
+				void (*apply)(DB& db, EntID eid, void* value);
+			};
+
+			struct Block
+			{
+				unique_ptr<unsigned char[]> data;
+				size_t size;
+			};
+
+			static constexpr size_t block_bytes = 16 * 1024;
+
+			vector<Command> commands;
+			vector<EntID> created;
+			vector<PendingComponent> batch;
+
+			vector<Block> blocks;
+			size_t block = 0;
+			size_t used = 0;
+
+			bool flushed = false;
+
+		public:
+			CommandBuffer() = default;
+
+			CommandBuffer(CommandBuffer&& other) :
+					commands(move(other.commands)),
+					created(move(other.created)),
+					batch(move(other.batch)),
+					blocks(move(other.blocks)),
+					block(other.block),
+					used(other.used),
+					flushed(other.flushed)
+			{
+				other.reset_moved();
+			}
+
+			CommandBuffer& operator=(CommandBuffer&& other)
+			{
+				if (this != &other)
+				{
+					// The pending values live in our blocks: destroy them first
+					clear();
+
+					commands = move(other.commands);
+					created = move(other.created);
+					batch = move(other.batch);
+					blocks = move(other.blocks);
+					block = other.block;
+					used = other.used;
+					flushed = other.flushed;
+
+					other.reset_moved();
+				}
+
+				return *this;
+			}
+
+			CommandBuffer(CommandBuffer const&) = delete;
+
+			CommandBuffer& operator=(CommandBuffer const&) = delete;
+
+			~CommandBuffer()
+			{
+				clear();
+			}
+
+			/*! Records the creation of an Entity.
+			 *
+			 * Returns a placeholder EntID, which can be given to the other
+			 * commands of this buffer. Placeholders are not valid in the
+			 * Database; use resolve() after flushing to get the real EntID.
+			 *
+			 * @return Placeholder EntID.
+			 */
+			EntID create_entity()
+			{
+				prepare();
+				created.emplace_back(uint32_t(created.size()), 0);
+				return created.back();
+			}
+
+			/*! Records the creation of a component.
+			 *
+			 * The value is moved into the buffer until it is flushed.
+			 *
+			 * @param eid Entity, or placeholder, to attach the component to.
+			 * @param com Component value.
+			 */
+			template<typename T>
+			void create_component(EntID eid, T com)
+			{
+				prepare();
+
+				void* value = push(sizeof(T), alignof(T));
+				::new(value) T(move(com));
+
+				commands.push_back({eid, Kind::create_component, {getTypeInfo<T>(), value}, &applyCreate<T>});
+			}
+
+			/*! Records the creation of a tag.
+			 *
+			 * @param eid Entity, or placeholder, to attach the tag to.
+			 */
+			template<typename T>
+			void create_component(EntID eid, Tag<T>)
+			{
+				prepare();
+				commands.push_back({eid, Kind::create_component, {getTypeInfo<Tag<T>>(), nullptr}, &applyCreateTag<T>});
+			}
+
+			/*! Records the erasure of a component.
+			 *
+			 * Does nothing on flush if the Entity has no such component.
+			 *
+			 * @tparam T Explicit type of the component.
+			 * @param eid Entity, or placeholder, owning the component.
+			 */
+			template<typename T>
+			void erase_component(EntID eid)
+			{
+				prepare();
+				commands.push_back({eid, Kind::erase_component, {getTypeInfo<T>(), nullptr}, &applyErase<T>});
+			}
+
+			/*! Records the erasure of an Entity.
+			 *
+			 * Later commands on the same Entity are ignored.
+			 *
+			 * @param eid Entity, or placeholder, to erase.
+			 */
+			void erase_entity(EntID eid)
+			{
+				prepare();
+				commands.push_back({eid, Kind::erase_entity, {nullptr, nullptr}, nullptr});
+			}
+
+			/*! Applies every recorded command to the Database.
+			 *
+			 * Entities are created first, then commands are applied grouped by
+			 * Entity. Commands on Entities that are not valid anymore are
+			 * ignored.
+			 *
+			 * @warning
+			 * Must not be called during a visit of the Database.
+			 *
+			 * @param db Database to apply the commands to.
+			 */
+			void flush(DB& db)
+			{
+				for (auto& eid : created)
+					eid = db.create_entity();
+
+				for (auto& cmd : commands)
+					cmd.eid = resolve(cmd.eid);
+
+				stable_sort(begin(commands), end(commands), [](Command const& a, Command const& b)
+				{
+					return a.eid.index() < b.eid.index();
+				});
+
+				for (size_t i = 0, e = commands.size(); i < e;)
+				{
+					auto& cmd = commands[i];
+
+					if (!db.valid(cmd.eid))
+					{
+						++i;
+						continue;
+					}
+
+					switch (cmd.kind)
+					{
+						case Kind::create_component:
+							i = create_run(db, i, HasCreateComponents<DB>{});
+							break;
+						case Kind::erase_component:
+							cmd.apply(db, cmd.eid, nullptr);
+							++i;
+							break;
+						case Kind::erase_entity:
+							db.erase_entity(cmd.eid);
+							++i;
+							break;
+					}
+				}
+
+				release();
+				flushed = true;
+			}
+
+			/*! Maps a placeholder to the Entity created for it.
+			 *
+			 * Valid after flush(), until the next command is recorded.
+			 * Other EntIDs are returned as is.
+			 *
+			 * @param eid Placeholder EntID.
+			 * @return Real EntID.
+			 */
+			EntID resolve(EntID eid) const
+			{
+				if (eid.generation() == 0 && eid.index() < created.size())
+					return created[eid.index()];
+				return eid;
+			}
+
+			/*! Discards every recorded command.
+			 */
+			void clear()
+			{
+				release();
+				created.clear();
+				flushed = false;
+			}
+
+			/*! Test for pending commands.
+			 *
+			 * @return True if no command is recorded.
+			 */
+			bool empty() const
+			{
+				return commands.empty() && (flushed || created.empty());
+			}
+
+		private:
+			template<typename T>
+			static void applyCreate(DB& db, EntID eid, void* value)
+			{
+				db.create_component(eid, move(*static_cast<T*>(value)));
+			}
+
+			template<typename T>
+			static void applyCreateTag(DB& db, EntID eid, void*)
+			{
+				db.create_component(eid, Tag<T>{});
+			}
+
+			template<typename T>
+			static void applyErase(DB& db, EntID eid, void*)
+			{
+				if (auto info = db.template get<T>(eid))
+					db.erase_component(info.id());
+			}
+
+			/// Applies a run of create_component commands on one Entity.
+			size_t create_run(DB& db, size_t first, true_type)
+			{
+				EntID eid = commands[first].eid;
+				size_t last = first;
+
+				batch.clear();
+				for (; last < commands.size() && commands[last].eid == eid && commands[last].kind == Kind::create_component; ++last)
+				{
+					batch.push_back(commands[last].com);
+					commands[last].com.value = nullptr;
+				}
+
+				db.create_components(eid, batch.data(), batch.size());
+				return last;
+			}
+
+			size_t create_run(DB& db, size_t first, false_type)
+			{
+				auto& cmd = commands[first];
+				cmd.apply(db, cmd.eid, cmd.com.value);
+				return first + 1;
+			}
+
+			/// Leaves a moved-from buffer empty and usable.
+			void reset_moved()
+			{
+				commands.clear();
+				created.clear();
+				batch.clear();
+				blocks.clear();
+				block = 0;
+				used = 0;
+				flushed = false;
+			}
+
+			/// Starts a new recording if the last one was flushed.
+			void prepare()
+			{
+				if (flushed)
+				{
+					created.clear();
+					flushed = false;
+				}
+			}
+
+			void* push(size_t size, size_t align)
+			{
+				while (true)
+				{
+					for (; block < blocks.size(); ++block, used = 0)
+					{
+						auto base = reinterpret_cast<uintptr_t>(blocks[block].data.get());
+						size_t offset = (base + used + align - 1) / align * align - base;
+
+						if (offset + size <= blocks[block].size)
+						{
+							used = offset + size;
+							return blocks[block].data.get() + offset;
+						}
+					}
+
+					size_t bytes = block_bytes;
+					bytes = max(bytes, size + align);
+					blocks.push_back({unique_ptr<unsigned char[]>(new unsigned char[bytes]), bytes});
+					block = blocks.size() - 1;
+					used = 0;
+				}
+			}
+
+			/// Destroys the values left in the buffer and recycles its blocks.
+			void release()
+			{
+				for (auto& cmd : commands)
+					if (cmd.com.value)
+						cmd.com.info->destroy(cmd.com.value);
+
+				commands.clear();
+				block = 0;
+				used = 0;
+			}
+		};
+
+	} // namespace _detail
+
+	using _detail::CommandBuffer;
+} // namespace ginseng
@@ -0,0 +1,397 @@
+#pragma once
+
+#include "../ginseng.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+namespace ginseng
+{
+	namespace _detail
+	{
+		/*! Entity hierarchy
+		 *
+		 * Parent/child relationships between the Entities of a Database,
+		 * kept next to it.
+		 *
+		 * Links are intrusive sibling lists indexed by Entity, so attaching
+		 * and detaching are constant time. From them, the hierarchy derives
+		 * a breadth-first order, where every node comes after its parent: a
+		 * transform propagation is then a single linear pass over that array,
+		 * with no recursion. The order is only rebuilt after a change, and is
+		 * only checked against the Database when its version() changed.
+		 *
+		 * Entities erased from the Database directly are dropped on the next
+		 * rebuild, or when their index is reused by an attached Entity; their
+		 * children become roots. Use erase() to destroy a whole subtree.
+		 *
+		 * @tparam DB Database type.
+		 */
+		template<typename DB>
+		class Hierarchy
+		{
+		public:
+			using EntID = typename DB::EntID;
+
+			/// Position of no node.
+			static constexpr uint32_t npos = numeric_limits<uint32_t>::max();
+
+			/// A node in breadth-first order.
+			struct Node
+			{
+				EntID eid;
+
+				/// Position of the parent in the order, or npos for roots.
+				uint32_t parent;
+
+				/// Number of ancestors.
+				uint32_t depth;
+			};
+
+		private:
+			struct Link
+			{
+				EntID eid;
+				EntID parent;
+				EntID first_child;
+				EntID prev;
+				EntID next;
+			};
+
+			/// Components of a node, in breadth-first order.
+			struct Target
+			{
+				void const* local;
+				void* world;
+
+				/// World component of the closest ancestor having one.
+				void const* parent;
+			};
+
+			vector<Link> links;
+			EntID first_root;
+
+			vector<Node> nodes;
+			bool dirty = false;
+			uint64_t seen_version = 0;
+
+			vector<EntID> scratch;
+
+			vector<Target> targets;
+			bool targets_stale = true;
+			uint64_t targets_version = 0;
+			GUID targets_local = 0;
+			GUID targets_world = 0;
+
+		public:
+			/*! Attach an Entity to a parent.
+			 *
+			 * The Entity is moved with its whole subtree. A default EntID as
+			 * parent makes the Entity a root; any other parent joins the
+			 * hierarchy as a root if it was not part of it.
+			 *
+			 * @warning
+			 * The parent must not be in the subtree of the Entity.
+			 *
+			 * @param eid Entity to attach.
+			 * @param parent New parent.
+			 */
+			void attach(EntID eid, EntID parent)
+			{
+				assert(!descends(parent, eid) && "Attaching an Entity below itself");
+
+				if (parent.generation() != 0 && !linked(parent))
+				{
+					assure(parent);
+					link(parent, {});
+				}
+
+				if (linked(eid))
+					unlink(eid);
+				else
+					assure(eid);
+
+				link(eid, parent);
+				dirty = true;
+			}
+
+			/*! Make an Entity a root, keeping its subtree.
+			 *
+			 * @param eid Entity to detach.
+			 */
+			void detach(EntID eid)
+			{
+				attach(eid, {});
+			}
+
+			/*! Test for membership.
+			 *
+			 * @param eid Entity to test.
+			 * @return True if the Entity is part of the hierarchy.
+			 */
+			bool linked(EntID eid) const
+			{
+				return eid.index() < links.size() && links[eid.index()].eid == eid;
+			}
+
+			/*! Parent of an Entity.
+			 *
+			 * @param eid Entity.
+			 * @return Its parent, or an invalid EntID for roots.
+			 */
+			EntID parent(EntID eid) const
+			{
+				return linked(eid) ? links[eid.index()].parent : EntID{};
+			}
+
+			/*! Call a function for each child of an Entity.
+			 *
+			 * @param eid Parent Entity.
+			 * @param func Called as `func(EntID)`.
+			 */
+			template<typename Func>
+			void each_child(EntID eid, Func&& func) const
+			{
+				if (!linked(eid))
+					return;
+
+				for (EntID child = links[eid.index()].first_child; linked(child); child = links[child.index()].next)
+					func(child);
+			}
+
+			/*! Remove an Entity from the hierarchy.
+			 *
+			 * Its children become roots. The Entity stays in the Database.
+			 *
+			 * @param eid Entity to remove.
+			 */
+			void remove(EntID eid)
+			{
+				if (!linked(eid))
+					return;
+
+				while (linked(links[eid.index()].first_child))
+				{
+					EntID child = links[eid.index()].first_child;
+					unlink(child);
+					link(child, {});
+				}
+
+				unlink(eid);
+				links[eid.index()].eid = {};
+				dirty = true;
+			}
+
+			/*! Erase a subtree.
+			 *
+			 * Erases the Entity and all of its descendants from the Database
+			 * and from the hierarchy.
+			 *
+			 * @param db Database owning the Entities.
+			 * @param eid Root of the subtree.
+			 */
+			void erase(DB& db, EntID eid)
+			{
+				if (!linked(eid))
+				{
+					if (db.valid(eid))
+						db.erase_entity(eid);
+					return;
+				}
+
+				unlink(eid);
+
+				scratch.clear();
+				scratch.push_back(eid);
+				for (size_t i = 0; i < scratch.size(); ++i)
+					for (EntID child = links[scratch[i].index()].first_child; linked(child); child = links[child.index()].next)
+						scratch.push_back(child);
+
+				for (auto e : scratch)
+				{
+					links[e.index()].eid = {};
+					if (db.valid(e))
+						db.erase_entity(e);
+				}
+
+				dirty = true;
+			}
+
+			/*! Breadth-first order.
+			 *
+			 * Roots come first, then their children, and so on; each node
+			 * comes after its parent. Rebuilt if the hierarchy changed.
+			 *
+			 * @param db Database owning the Entities.
+			 * @return Nodes in breadth-first order.
+			 */
+			vector<Node> const& order(DB const& db)
+			{
+				if (!dirty && db.version() != seen_version)
+					dirty = any_of(begin(nodes), end(nodes), [&](Node const& n) { return !db.valid(n.eid); });
+
+				seen_version = db.version();
+
+				if (dirty)
+					rebuild(db);
+
+				return nodes;
+			}
+
+			/*! Propagate values from parents to children.
+			 *
+			 * Computes a World component for each node from its Local
+			 * component and the World component of its parent, in a single
+			 * pass over the breadth-first order.
+			 *
+			 * Nodes missing either component are skipped; their children use
+			 * the closest ancestor having a World component.
+			 *
+			 * The components of every node are looked up once, then reused
+			 * until the order or the version() of the Database changes.
+			 *
+			 * @warning
+			 * combine must not create or erase Entities or components.
+			 *
+			 * @param db Database owning the Entities.
+			 * @param combine Called as `combine(World const* parent, Local const& local)`,
+			 * with a null parent for roots; returns the World value.
+			 * @tparam Local Local component type.
+			 * @tparam World Propagated component type.
+			 */
+			template<typename Local, typename World, typename Combine>
+			void propagate(DB& db, Combine&& combine)
+			{
+				auto& order = this->order(db);
+
+				if (targets_stale || targets_version != db.version() || targets_local != getGUID<Local>() || targets_world != getGUID<World>())
+					gather<Local, World>(db, order);
+
+				for (auto& target : targets)
+					if (target.world)
+						*static_cast<World*>(target.world) = combine(static_cast<World const*>(target.parent), *static_cast<Local const*>(target.local));
+			}
+
+		private:
+			template<typename Local, typename World>
+			void gather(DB& db, vector<Node> const& order)
+			{
+				targets.resize(order.size());
+
+				for (size_t i = 0; i < order.size(); ++i)
+				{
+					auto& node = order[i];
+					auto& target = targets[i];
+
+					void const* parent = nullptr;
+					if (node.parent != npos)
+					{
+						auto& above = targets[node.parent];
+						parent = above.world ? above.world : above.parent;
+					}
+
+					auto local = db.template get<Local>(node.eid);
+					auto world = db.template get<World>(node.eid);
+
+					bool both = local && world;
+					target.local = both ? &local.data() : nullptr;
+					target.world = both ? &world.data() : nullptr;
+					target.parent = parent;
+				}
+
+				// Looking components up may copy chunks shared with a Snapshot
+				targets_stale = false;
+				targets_version = db.version();
+				targets_local = getGUID<Local>();
+				targets_world = getGUID<World>();
+			}
+
+			void assure(EntID eid)
+			{
+				if (eid.index() >= links.size())
+					links.resize(eid.index() + 1);
+
+				// An Entity erased from the Database directly left its index to this one
+				EntID stale = links[eid.index()].eid;
+				if (stale.generation() != 0 && stale != eid)
+					remove(stale);
+
+				links[eid.index()] = {eid, {}, {}, {}, {}};
+			}
+
+			/// True if eid is ancestor, or is itself.
+			bool descends(EntID eid, EntID ancestor) const
+			{
+				for (; linked(eid); eid = links[eid.index()].parent)
+					if (eid == ancestor)
+						return true;
+
+				return false;
+			}
+
+			EntID& head(EntID parent)
+			{
+				return linked(parent) ? links[parent.index()].first_child : first_root;
+			}
+
+			void link(EntID eid, EntID parent)
+			{
+				auto& node = links[eid.index()];
+				auto& first = head(parent);
+
+				node.parent = parent;
+				node.prev = {};
+				node.next = first;
+
+				if (linked(first))
+					links[first.index()].prev = eid;
+
+				first = eid;
+			}
+
+			void unlink(EntID eid)
+			{
+				auto& node = links[eid.index()];
+
+				if (linked(node.prev))
+					links[node.prev.index()].next = node.next;
+				else
+					head(node.parent) = node.next;
+
+				if (linked(node.next))
+					links[node.next.index()].prev = node.prev;
+
+				node.parent = node.prev = node.next = {};
+			}
+
+			void rebuild(DB const& db)
+			{
+				// Entities erased behind our back leave, their children become roots
+				for (auto& link : links)
+					if (link.eid.generation() != 0 && !db.valid(link.eid))
+						remove(link.eid);
+
+				nodes.clear();
+
+				for (EntID root = first_root; linked(root); root = links[root.index()].next)
+					nodes.push_back({root, npos, 0});
+
+				for (size_t i = 0; i < nodes.size(); ++i)
+				{
+					uint32_t depth = nodes[i].depth + 1;
+					for (EntID child = links[nodes[i].eid.index()].first_child; linked(child); child = links[child.index()].next)
+						nodes.push_back({child, uint32_t(i), depth});
+				}
+
+				dirty = false;
+				targets_stale = true;
+			}
+		};
+
+		template<typename DB>
+		constexpr uint32_t Hierarchy<DB>::npos;
+
+	} // namespace _detail
+
+	using _detail::Hierarchy;
+} // namespace ginseng
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "../ginseng.hpp"
+
+#include <cassert>
+#include <atomic>
+#include <new>
+
+namespace ginseng
+{
+	namespace _detail
+	{
+		/*! Slab pool
+		 *
+		 * Hands out blocks of one size, carved from slabs of many blocks.
+		 * Freed blocks are kept on an intrusive free list and reused first, so
+		 * allocating from a warm pool never reaches the system allocator.
+		 *
+		 * Pools are never destroyed, so that objects outliving static
+		 * destruction can still be deallocated.
+		 */
+		class SlabPool
+		{
+			struct Node
+			{
+				Node* next;
+			};
+
+			static constexpr size_t slab_bytes = 64 * 1024;
+
+			size_t block_size;
+			size_t block_align;
+			size_t blocks_per_slab;
+
+			vector<pair<void*, unsigned char*>> slabs;
+			Node* free_list = nullptr;
+			size_t live = 0;
+
+			/// Blocks hold trivially destructible objects, which reset() may drop.
+			bool trivial;
+
+			atomic_flag lock = ATOMIC_FLAG_INIT;
+
+			class Guard
+			{
+				atomic_flag& flag;
+
+			public:
+				Guard(atomic_flag& f) : flag(f)
+				{
+					while (flag.test_and_set(memory_order_acquire))
+					{ }
+				}
+
+				~Guard()
+				{
+					flag.clear(memory_order_release);
+				}
+			};
+
+			void grow()
+			{
+				size_t bytes = block_size * blocks_per_slab + block_align;
+				void* raw = ::operator new(bytes);
+				auto base = static_cast<unsigned char*>(raw);
+				base += (block_align - reinterpret_cast<uintptr_t>(base) % block_align) % block_align;
+
+				slabs.emplace_back(raw, base);
+				thread(base);
+			}
+
+			/// Pushes every block of a slab on the free list, in address order.
+			void thread(unsigned char* base)
+			{
+				for (size_t i = blocks_per_slab; i-- > 0;)
+				{
+					auto node = reinterpret_cast<Node*>(base + i * block_size);
+					node->next = free_list;
+					free_list = node;
+				}
+			}
+
+		public:
+			SlabPool(size_t size, size_t align, bool trivially_destructible = false) :
+					block_align(max(align, alignof(Node))),
+					blocks_per_slab(0),
+					trivial(trivially_destructible)
+			{
+				block_size = (max(size, sizeof(Node)) + block_align - 1) / block_align * block_align;
+				blocks_per_slab = max<size_t>(16, slab_bytes / block_size);
+			}
+
+			SlabPool(SlabPool const&) = delete;
+
+			SlabPool& operator=(SlabPool const&) = delete;
+
+			void* allocate()
+			{
+				Guard guard(lock);
+
+				if (!free_list)
+					grow();
+
+				Node* node = free_list;
+				free_list = node->next;
+				++live;
+				return node;
+			}
+
+			void deallocate(void* ptr)
+			{
+				Guard guard(lock);
+
+				auto node = static_cast<Node*>(ptr);
+				node->next = free_list;
+				free_list = node;
+				--live;
+			}
+
+			/// Makes sure at least n blocks can be allocated without growing.
+			void reserve(size_t n)
+			{
+				Guard guard(lock);
+
+				size_t capacity = slabs.size() * blocks_per_slab;
+				while (capacity < live + n)
+				{
+					grow();
+					capacity += blocks_per_slab;
+				}
+			}
+
+			/*! Bulk reset.
+			 *
+			 * Frees every block at once, allocated or not, like an arena:
+			 * objects still living in the pool are dropped without being
+			 * destroyed, in constant time per slab. The free list is rebuilt
+			 * in address order, so the next allocations are contiguous again.
+			 * Memory is kept for reuse.
+			 *
+			 * @warning
+			 * Live blocks are only allowed in pools of trivially destructible
+			 * objects. Pointers to them dangle, and must not be deallocated.
+			 */
+			void reset()
+			{
+				Guard guard(lock);
+				assert((trivial || live == 0) && "SlabPool reset with live blocks of a non-trivial type");
+
+				live = 0;
+				free_list = nullptr;
+				for (size_t i = slabs.size(); i-- > 0;)
+					thread(slabs[i].second);
+			}
+
+			/*! Returns the memory of this pool to the system.
+			 *
+			 * Does nothing if some blocks are still allocated.
+			 */
+			void release()
+			{
+				Guard guard(lock);
+
+				if (live != 0)
+					return;
+
+				for (auto& slab : slabs)
+					::operator delete(slab.first);
+
+				slabs.clear();
+				free_list = nullptr;
+			}
+
+			/// Number of blocks currently allocated.
+			size_t size() const
+			{
+				return live;
+			}
+		};
+
+		inline vector<SlabPool*>& slabPools()
+		{
+			static auto pools = new vector<SlabPool*>();
+			return *pools;
+		}
+
+		inline atomic_flag& slabPoolsLock()
+		{
+			static atomic_flag lock = ATOMIC_FLAG_INIT;
+			return lock;
+		}
+
+		template<typename Fn>
+		void forEachSlabPool(Fn fn)
+		{
+			while (slabPoolsLock().test_and_set(memory_order_acquire))
+			{ }
+
+			for (auto pool : slabPools())
+				fn(*pool);
+
+			slabPoolsLock().clear(memory_order_release);
+		}
+
+		inline SlabPool* registerSlabPool(SlabPool* pool)
+		{
+			while (slabPoolsLock().test_and_set(memory_order_acquire))
+			{ }
+
+			slabPools().push_back(pool);
+
+			slabPoolsLock().clear(memory_order_release);
+			return pool;
+		}
+
+		/*! Pool allocator
+		 *
+		 * A stateless allocator drawing single objects from a slab pool
+		 * dedicated to T. Arrays are forwarded to the global operator new.
+		 *
+		 * Used as `Database<PoolAllocator>`, every component (along with its
+		 * shared_ptr control block) comes from a per-type pool, so same-type
+		 * components end up next to each other and creating them does not
+		 * reach malloc once the pool is warm.
+		 *
+		 * Pools are guarded by a spin lock, since they are shared by every
+		 * Database and thread.
+		 *
+		 * @tparam T Allocated type.
+		 */
+		template<typename T>
+		class PoolAllocator
+		{
+		public:
+			using value_type = T;
+
+			template<typename U>
+			struct rebind
+			{
+				using other = PoolAllocator<U>;
+			};
+
+			PoolAllocator() noexcept = default;
+
+			template<typename U>
+			PoolAllocator(PoolAllocator<U> const&) noexcept
+			{ }
+
+			T* allocate(size_t n)
+			{
+				if (n == 1)
+					return static_cast<T*>(pool().allocate());
+
+				return static_cast<T*>(::operator new(n * sizeof(T)));
+			}
+
+			void deallocate(T* ptr, size_t n) noexcept
+			{
+				if (n == 1)
+					pool().deallocate(ptr);
+				else
+					::operator delete(ptr);
+			}
+
+			/*! Frees every T at once.
+			 *
+			 * Drops all the objects allocated from the pool of T without
+			 * destroying them, such as a wave of bullets allocated one by
+			 * one. Only for trivially destructible types.
+			 *
+			 * @warning
+			 * Pointers to the objects dangle, and must not be deallocated.
+			 * The pool of T is shared by every container using
+			 * PoolAllocator<T>, including the internal arrays of a Database
+			 * holding T: none of them may be alive.
+			 */
+			static void reset()
+			{
+				static_assert(is_trivially_destructible<T>::value, "Only pools of trivially destructible types can be reset with live objects");
+				pool().reset();
+			}
+
+			/// Pool of T.
+			static SlabPool& pool()
+			{
+				static SlabPool* instance = registerSlabPool(new SlabPool(sizeof(T), alignof(T), is_trivially_destructible<T>::value));
+				return *instance;
+			}
+		};
+
+		template<typename T, typename U>
+		bool operator==(PoolAllocator<T> const&, PoolAllocator<U> const&) noexcept
+		{
+			return true;
+		}
+
+		template<typename T, typename U>
+		bool operator!=(PoolAllocator<T> const&, PoolAllocator<U> const&) noexcept
+		{
+			return false;
+		}
+
+		/*! Bulk reset of every pool.
+		 *
+		 * Resets the empty pools, whose free lists are rebuilt in address
+		 * order, so the next allocations are contiguous again. Pools still
+		 * holding objects are left alone, whatever their type: a live
+		 * Database draws its internal arrays of a single element from the
+		 * pools too. Memory is kept. Meant for level transitions, once the
+		 * Databases are cleared or destroyed.
+		 *
+		 * Use PoolAllocator<T>::reset() to drop the objects of a single
+		 * pool of trivially destructible objects.
+		 */
+		inline void reset_pools()
+		{
+			forEachSlabPool([](SlabPool& pool)
+			{
+				if (pool.size() == 0)
+					pool.reset();
+			});
+		}
+
+		/*! Returns the memory of every empty pool to the system.
+		 */
+		inline void release_pools()
+		{
+			forEachSlabPool([](SlabPool& pool) { pool.release(); });
+		}
+
+	} // namespace _detail
+
+	using _detail::PoolAllocator;
+	using _detail::reset_pools;
+	using _detail::release_pools;
+} // namespace ginseng
@@ -0,0 +1,527 @@
+#pragma once
+
+#include "../ginseng.hpp"
+
+#include <type_traits>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace ginseng
+{
+	namespace _detail
+	{
+		/*! Snapshot writer
+		 *
+		 * Appends raw bytes to a snapshot. Handed to the save functions of
+		 * registered components.
+		 */
+		class SnapshotWriter
+		{
+			vector<unsigned char>& out;
+
+		public:
+			explicit SnapshotWriter(vector<unsigned char>& o) : out(o)
+			{ }
+
+			void write(void const* data, size_t size)
+			{
+				size_t pos = out.size();
+				out.resize(pos + size);
+				if (size != 0)
+					memcpy(out.data() + pos, data, size);
+			}
+
+			template<typename T>
+			void write(T const& value)
+			{
+				static_assert(is_trivially_copyable<T>::value, "Only trivially copyable values can be written directly");
+				write(&value, sizeof(T));
+			}
+
+			/// Overwrites a value written earlier.
+			template<typename T>
+			void write_at(size_t pos, T const& value)
+			{
+				memcpy(out.data() + pos, &value, sizeof(T));
+			}
+
+			/// Number of bytes written so far.
+			size_t size() const
+			{
+				return out.size();
+			}
+		};
+
+		/*! Snapshot reader
+		 *
+		 * Reads raw bytes from a snapshot. Handed to the load functions of
+		 * registered components.
+		 *
+		 * Reading past the end fails: the reader stops, the value read is
+		 * zeroed and ok() becomes false.
+		 */
+		class SnapshotReader
+		{
+			unsigned char const* pos;
+			unsigned char const* last;
+			bool failed = false;
+
+		public:
+			SnapshotReader(unsigned char const* data, size_t size) : pos(data), last(data + size)
+			{ }
+
+			bool read(void* data, size_t size)
+			{
+				if (failed || size > remaining())
+				{
+					failed = true;
+					if (size != 0)
+						memset(data, 0, size);
+					return false;
+				}
+
+				if (size != 0)
+					memcpy(data, pos, size);
+				pos += size;
+				return true;
+			}
+
+			template<typename T>
+			T read()
+			{
+				static_assert(is_trivially_copyable<T>::value, "Only trivially copyable values can be read directly");
+
+				T value;
+				read(&value, sizeof(T));
+				return value;
+			}
+
+			/// Skips some bytes, returning them, or nullptr past the end.
+			unsigned char const* skip(size_t size)
+			{
+				if (failed || size > remaining())
+				{
+					failed = true;
+					return nullptr;
+				}
+
+				auto rv = pos;
+				pos += size;
+				return rv;
+			}
+
+			size_t remaining() const
+			{
+				return size_t(last - pos);
+			}
+
+			bool ok() const
+			{
+				return !failed;
+			}
+		};
+
+		/*! Database serializer
+		 *
+		 * Writes the components of a Database to a compact binary snapshot,
+		 * and restores snapshots into a Database.
+		 *
+		 * Only registered component types are saved. Trivially copyable
+		 * components are stored as raw bytes and restored with one memcpy per
+		 * type, then handed to `create_components()`; other types provide a
+		 * pair of save and load functions. Empty types, such as Tags, take no
+		 * space besides the list of their Entities.
+		 *
+		 * Snapshots are laid out by component type:
+		 *  - a header with the number of Entities,
+		 *  - per registered type: its GUID, the number of components, the
+		 *    position of their Entities in the snapshot, and their values.
+		 *
+		 * Values are stored in the native byte order and layout, so snapshots
+		 * are meant to be read back by the same build, for saves, rollback or
+		 * state transitions. Sections of unregistered types are skipped.
+		 *
+		 * A Serializer keeps its scratch buffers, so saving repeatedly into
+		 * the same snapshot does not allocate once warm. Loading constructs
+		 * the components of each section in place in a reused buffer, so
+		 * only the Database allocates, as it creates Entities and
+		 * components.
+		 *
+		 * @tparam DB Database type.
+		 */
+		template<typename DB>
+		class Serializer
+		{
+			using EntID = typename DB::EntID;
+
+			static constexpr uint32_t magic = 0x504E5347; // "GSNP"
+			static constexpr uint32_t version = 1;
+			static constexpr uint32_t npos = numeric_limits<uint32_t>::max();
+
+			/// Entities being saved, and their position in the snapshot.
+			struct Selection
+			{
+				vector<EntID> entities;
+				vector<uint32_t> positions;
+
+				uint32_t position(EntID eid) const
+				{
+					return eid.index() < positions.size() ? positions[eid.index()] : npos;
+				}
+			};
+
+			struct Found
+			{
+				vector<uint32_t> positions;
+				vector<void const*> coms;
+			};
+
+			/// Raw memory holding the components of one section while loading.
+			struct Scratch
+			{
+				unique_ptr<unsigned char[]> data;
+				size_t size = 0;
+
+				/// Room for count Ts, grown if needed.
+				template<typename T>
+				T* get(size_t count)
+				{
+					size_t bytes = count * sizeof(T) + alignof(T);
+					if (bytes > size)
+					{
+						data.reset(new unsigned char[bytes]);
+						size = bytes;
+					}
+
+					auto base = reinterpret_cast<uintptr_t>(data.get());
+					return reinterpret_cast<T*>(data.get() + (alignof(T) - base % alignof(T)) % alignof(T));
+				}
+			};
+
+			/// Section of one component type, as read from a snapshot.
+			struct Section
+			{
+				GUID guid;
+				uint64_t num;
+				uint64_t bytes;
+				unsigned char const* positions;
+				unsigned char const* payload;
+			};
+
+			struct Entry
+			{
+				GUID guid;
+				function<void(SnapshotWriter&, DB const&, Selection const&, Found&)> save;
+				function<void(SnapshotReader&, DB&, EntID const*, size_t, Scratch&)> load;
+			};
+
+			template<typename... Ts>
+			struct Collector
+			{
+				vector<EntID>* out;
+
+				void operator()(EntID eid, Ts const& ...) const
+				{
+					out->push_back(eid);
+				}
+			};
+
+			vector<Entry> entries;
+
+			Selection selection;
+			Found found;
+			vector<EntID> eids;
+			Scratch scratch;
+
+		public:
+			/*! Registers a trivially copyable component type.
+			 *
+			 * Its values are saved and restored as raw bytes.
+			 *
+			 * @tparam T Component type.
+			 */
+			template<typename T>
+			void register_component()
+			{
+				static_assert(is_trivially_copyable<T>::value, "Components that are not trivially copyable need save and load functions");
+
+				add<T>([](SnapshotWriter& writer, T const& com)
+				{
+					writer.write(&com, sizeof(T));
+				}, [](SnapshotReader& reader, T* coms, size_t count)
+				{
+					reader.read(coms, sizeof(T) * count);
+					return count;
+				});
+			}
+
+			/*! Registers a component type with its own format.
+			 *
+			 * @param save Called as `save(writer, com)` for each component.
+			 * @param load Called as `load(reader)` for each component, in the
+			 * same order; returns the component, which is constructed in place
+			 * from it.
+			 * @tparam T Component type.
+			 */
+			template<typename T, typename Save, typename Load>
+			void register_component(Save save, Load load)
+			{
+				add<T>(move(save), [load](SnapshotReader& reader, T* coms, size_t count)
+				{
+					size_t i = 0;
+					for (; i < count && reader.ok(); ++i)
+						::new(coms + i) T(load(reader));
+					return i;
+				});
+			}
+
+			/*! Saves every Entity of the Database.
+			 *
+			 * The previous content of the snapshot is replaced; its memory is
+			 * reused.
+			 *
+			 * @param db Database to save.
+			 * @param out Snapshot.
+			 */
+			void save(DB const& db, vector<unsigned char>& out)
+			{
+				save_query<>(db, out);
+			}
+
+			/*! Saves the Entities matching a query.
+			 *
+			 * Only the Entities a visitor taking `Ts...` would visit are saved,
+			 * along with all of their registered components.
+			 *
+			 * @param db Database to save.
+			 * @param out Snapshot.
+			 * @tparam Ts Visitor parameters selecting the Entities.
+			 */
+			template<typename... Ts>
+			void save_query(DB const& db, vector<unsigned char>& out)
+			{
+				selection.entities.clear();
+				db.visit(Collector<Ts...>{&selection.entities});
+
+				selection.positions.clear();
+				for (size_t i = 0; i < selection.entities.size(); ++i)
+				{
+					auto index = selection.entities[i].index();
+					if (index >= selection.positions.size())
+						selection.positions.resize(index + 1, npos);
+					selection.positions[index] = uint32_t(i);
+				}
+
+				out.clear();
+				SnapshotWriter writer(out);
+				writer.write(magic);
+				writer.write(version);
+				writer.write(uint64_t(selection.entities.size()));
+				writer.write(uint64_t(entries.size()));
+
+				for (auto& entry : entries)
+					entry.save(writer, db, selection, found);
+			}
+
+			/*! Restores a snapshot.
+			 *
+			 * Creates one new Entity per saved Entity, then creates their
+			 * components with one `create_components()` call per type. The
+			 * Database is not cleared first.
+			 *
+			 * A truncated or foreign snapshot is detected before anything is
+			 * created.
+			 *
+			 * @warning
+			 * A snapshot whose component values fail to load is applied
+			 * partially.
+			 *
+			 * @param db Database to restore into.
+			 * @param data Snapshot.
+			 * @param size Snapshot size, in bytes.
+			 * @param created If given, receives the new Entities, in saved order.
+			 * @return True if the snapshot was read entirely.
+			 */
+			bool load(DB& db, unsigned char const* data, size_t size, vector<EntID>* created = nullptr)
+			{
+				SnapshotReader reader(data, size);
+
+				if (reader.read<uint32_t>() != magic || reader.read<uint32_t>() != version)
+					return false;
+
+				auto count = reader.read<uint64_t>();
+				auto sections = reader.read<uint64_t>();
+
+				if (!reader.ok() || count >= npos)
+					return false;
+
+				// Check the framing of every section before touching the Database
+				SnapshotReader check = reader;
+				Section section;
+
+				for (uint64_t s = 0; s < sections; ++s)
+				{
+					if (!next_section(check, count, section))
+						return false;
+
+					for (uint64_t i = 0; i < section.num; ++i)
+						if (position(section, size_t(i)) >= count)
+							return false;
+				}
+
+				auto entities = db.create_entities(size_t(count));
+
+				for (uint64_t s = 0; s < sections; ++s)
+				{
+					next_section(reader, count, section);
+
+					auto entry = find_if(begin(entries), end(entries), [&](Entry const& e) { return e.guid == section.guid; });
+					if (entry == end(entries))
+						continue;
+
+					eids.resize(size_t(section.num));
+					for (size_t i = 0; i < eids.size(); ++i)
+						eids[i] = entities[position(section, i)];
+
+					SnapshotReader values(section.payload, size_t(section.bytes));
+					entry->load(values, db, eids.data(), eids.size(), scratch);
+
+					if (!values.ok())
+						return false;
+				}
+
+				if (created)
+					*created = move(entities);
+
+				return reader.ok();
+			}
+
+			/*! Restores a snapshot.
+			 *
+			 * @param db Database to restore into.
+			 * @param data Snapshot.
+			 * @param created If given, receives the new Entities, in saved order.
+			 * @return True if the snapshot was read entirely.
+			 */
+			bool load(DB& db, vector<unsigned char> const& data, vector<EntID>* created = nullptr)
+			{
+				return load(db, data.data(), data.size(), created);
+			}
+
+		private:
+			/// Reads the header of a section and skips its data.
+			static bool next_section(SnapshotReader& reader, uint64_t count, Section& section)
+			{
+				section.guid = reader.read<GUID>();
+				section.num = reader.read<uint64_t>();
+				section.bytes = reader.read<uint64_t>();
+
+				// Checked before multiplying, so that a corrupt size cannot overflow
+				if (!reader.ok() || section.num > count || section.num > reader.remaining() / sizeof(uint32_t))
+					return false;
+
+				section.positions = reader.skip(size_t(section.num) * sizeof(uint32_t));
+
+				if (section.bytes > reader.remaining())
+					return false;
+
+				section.payload = reader.skip(size_t(section.bytes));
+				return reader.ok();
+			}
+
+			static uint32_t position(Section const& section, size_t i)
+			{
+				uint32_t pos;
+				memcpy(&pos, section.positions + i * sizeof(uint32_t), sizeof(uint32_t));
+				return pos;
+			}
+
+			/// Empty components take no space: they are default constructed.
+			template<typename T, typename LoadAll>
+			static size_t load_values(SnapshotReader&, T* coms, size_t count, LoadAll const&, true_type)
+			{
+				for (size_t i = 0; i < count; ++i)
+					::new(coms + i) T();
+				return count;
+			}
+
+			template<typename T, typename LoadAll>
+			static size_t load_values(SnapshotReader& reader, T* coms, size_t count, LoadAll const& load, false_type)
+			{
+				return load(reader, coms, count);
+			}
+
+			template<typename T, typename Save, typename LoadAll>
+			void add(Save save, LoadAll load)
+			{
+				Entry entry;
+				entry.guid = getGUID<T>();
+
+				entry.save = [save](SnapshotWriter& writer, DB const& db, Selection const& sel, Found& found)
+				{
+					found.positions.clear();
+					found.coms.clear();
+
+					db.visit([&](EntID eid, T const& com)
+					{
+						auto pos = sel.position(eid);
+						if (pos != npos)
+						{
+							found.positions.push_back(pos);
+							found.coms.push_back(&com);
+						}
+					});
+
+					writer.write(getGUID<T>());
+					writer.write(uint64_t(found.positions.size()));
+
+					size_t bytes_at = writer.size();
+					writer.write(uint64_t(0));
+					writer.write(found.positions.data(), found.positions.size() * sizeof(uint32_t));
+
+					size_t first = writer.size();
+					if (!is_empty<T>::value)
+						for (auto com : found.coms)
+							save(writer, *static_cast<T const*>(com));
+
+					writer.write_at(bytes_at, uint64_t(writer.size() - first));
+				};
+
+				entry.load = [load](SnapshotReader& reader, DB& db, EntID const* eids, size_t count, Scratch& scratch)
+				{
+					T* coms = scratch.template get<T>(count);
+					size_t made = load_values(reader, coms, count, load, is_empty<T>{});
+
+					if (reader.ok())
+						db.create_components(eids, coms, made);
+
+					if (!is_trivially_destructible<T>::value)
+						for (size_t i = 0; i < made; ++i)
+							coms[i].~T();
+				};
+
+				auto pos = find_if(begin(entries), end(entries), [&](Entry const& e) { return e.guid == entry.guid; });
+				if (pos != end(entries))
+					*pos = move(entry);
+				else
+					entries.push_back(move(entry));
+			}
+		};
+
+		template<typename DB>
+		constexpr uint32_t Serializer<DB>::magic;
+
+		template<typename DB>
+		constexpr uint32_t Serializer<DB>::version;
+
+		template<typename DB>
+		constexpr uint32_t Serializer<DB>::npos;
+
+	} // namespace _detail
+
+	using _detail::SnapshotWriter;
+	using _detail::SnapshotReader;
+	using _detail::Serializer;
+} // namespace ginseng
@@ -0,0 +1,2046 @@
+#pragma once
+
+#include "../ginseng.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+namespace ginseng
+{
+	namespace _detail
+	{
+		/*! Sparse Database
+		 *
+		 * An Entity component Database that keeps one pool per component type.
+		 * Each pool is a sparse set: a dense array of components, a parallel
+		 * dense array of Entity indices, and a paged sparse array mapping Entity
+		 * indices back to dense positions.
+		 *
+		 * Looking up, creating and erasing a component are constant time.
+		 * Visiting iterates the dense array of one pool and probes the others.
+		 *
+		 * Components are stored by value in vectors using the given allocator.
+		 *
+		 * Entity and component values are not reachable outside of the
+		 * Database, therefore emplace/displace functions are not provided.
+		 *
+		 * @warning
+		 * This container does not perform any synchronization. Therefore, it is not
+		 * considered "thread-safe".
+		 *
+		 * Changes are tracked per component: `Changed<T>` visits only match
+		 * the Entities whose T was created or written since the given tick.
+		 *
+		 * Pools can be sorted, and owning groups keep the Entities having a
+		 * set of components packed at the front of their pools, in the same
+		 * order, for the tightest loops.
+		 *
+		 * @warning
+		 * Creating or erasing a component may move other components of the same
+		 * type. References to components of that type are invalidated.
+		 *
+		 * @tparam AllocatorT Component allocator.
+		 */
+		template<template<typename> class AllocatorT>
+		class Database<AllocatorT, SparseStorage>
+		{
+		public:
+			// IDs
+
+			using EntID = _detail::EntID;
+
+			class ComID;
+
+			template<typename Com>
+			class ComInfo;
+
+			template<typename... Ts>
+			class View;
+
+			template<typename... Ts>
+			class CachedView;
+
+			template<typename... Ts>
+			class Group;
+
+		private:
+			using EntIndex = uint32_t;
+
+			template<typename T>
+			using AllocVector = vector<T, AllocatorT<T>>;
+
+			/*! Sparse set of Entity indices.
+			 *
+			 * The sparse array is paged, so a pool only pays for the ranges of
+			 * Entity indices it actually contains.
+			 */
+			class SparseSet
+			{
+				static constexpr EntIndex npos = numeric_limits<EntIndex>::max();
+				static constexpr size_t page_bits = 12;
+				static constexpr size_t page_size = size_t(1) << page_bits;
+
+				vector<unique_ptr<EntIndex[]>> pages;
+				AllocVector<EntIndex> packed;
+
+				EntIndex& slot(EntIndex e) const
+				{
+					return pages[e >> page_bits][e & (page_size - 1)];
+				}
+
+				EntIndex& assure(EntIndex e)
+				{
+					size_t page = e >> page_bits;
+
+					if (page >= pages.size())
+						pages.resize(page + 1);
+
+					if (!pages[page])
+					{
+						pages[page].reset(new EntIndex[page_size]);
+						fill_n(pages[page].get(), page_size, EntIndex(npos));
+					}
+
+					return slot(e);
+				}
+
+			public:
+				bool has(EntIndex e) const
+				{
+					size_t page = e >> page_bits;
+					return page < pages.size() && pages[page] && slot(e) != npos;
+				}
+
+				/// Dense position of an Entity, which must be in the set.
+				size_t index(EntIndex e) const
+				{
+					return slot(e);
+				}
+
+				void insert(EntIndex e)
+				{
+					assure(e) = EntIndex(packed.size());
+					packed.push_back(e);
+				}
+
+				/// Makes room for n more Entities.
+				void reserve(size_t n)
+				{
+					packed.reserve(packed.size() + n);
+				}
+
+				/// Exchanges the Entities at two dense positions.
+				void swap_positions(size_t a, size_t b)
+				{
+					swap(packed[a], packed[b]);
+					slot(packed[a]) = EntIndex(a);
+					slot(packed[b]) = EntIndex(b);
+				}
+
+				/// Releases spare capacity, and the pages left empty.
+				void shrink()
+				{
+					packed.shrink_to_fit();
+
+					for (auto& page : pages)
+						if (page && all_of(page.get(), page.get() + page_size, [](EntIndex i) { return i == npos; }))
+							page.reset();
+
+					while (!pages.empty() && !pages.back())
+						pages.pop_back();
+
+					pages.shrink_to_fit();
+				}
+
+				/// Removes an Entity by moving the last one into its position.
+				void erase(EntIndex e)
+				{
+					EntIndex pos = slot(e);
+					EntIndex last = packed.back();
+
+					packed[pos] = last;
+					slot(last) = pos;
+					slot(e) = npos;
+					packed.pop_back();
+				}
+
+				size_t size() const
+				{
+					return packed.size();
+				}
+
+				EntIndex const* entities() const
+				{
+					return packed.data();
+				}
+			};
+
+			class PoolBase : public SparseSet
+			{
+			public:
+				virtual ~PoolBase()
+				{ }
+
+				virtual void remove(EntIndex e) = 0;
+
+				/// Exchanges the components at two dense positions.
+				virtual void swap_at(size_t a, size_t b) = 0;
+
+				/// Releases spare capacity.
+				virtual void shrink()
+				{
+					SparseSet::shrink();
+				}
+			};
+
+			template<typename T>
+			class Pool : public PoolBase
+			{
+				AllocVector<T> values;
+
+				/// Change tick of each value.
+				AllocVector<uint64_t> ticks;
+
+			public:
+				T& emplace(EntIndex e, T com, uint64_t tick)
+				{
+					if (this->has(e))
+					{
+						size_t pos = this->index(e);
+						ticks[pos] = tick;
+						return values[pos] = move(com);
+					}
+
+					this->insert(e);
+					values.push_back(move(com));
+					ticks.push_back(tick);
+					return values.back();
+				}
+
+				T& get(EntIndex e)
+				{
+					return values[this->index(e)];
+				}
+
+				void reserve(size_t n)
+				{
+					SparseSet::reserve(n);
+					values.reserve(values.size() + n);
+					ticks.reserve(ticks.size() + n);
+				}
+
+				T* data()
+				{
+					return values.data();
+				}
+
+				uint64_t& tick_at(size_t pos)
+				{
+					return ticks[pos];
+				}
+
+				void shrink() override
+				{
+					SparseSet::shrink();
+					values.shrink_to_fit();
+					ticks.shrink_to_fit();
+				}
+
+				void swap_at(size_t a, size_t b) override
+				{
+					if (a == b)
+						return;
+
+					swap(values[a], values[b]);
+					swap(ticks[a], ticks[b]);
+					this->swap_positions(a, b);
+				}
+
+				void remove(EntIndex e) override
+				{
+					size_t pos = this->index(e);
+					if (pos + 1 != values.size())
+					{
+						values[pos] = move(values.back());
+						ticks[pos] = ticks.back();
+					}
+					values.pop_back();
+					ticks.pop_back();
+					this->erase(e);
+				}
+			};
+
+			template<typename T>
+			class Pool<Tag<T>> : public PoolBase
+			{
+			public:
+				void emplace(EntIndex e, Tag<T>, uint64_t)
+				{
+					if (!this->has(e))
+						this->insert(e);
+				}
+
+				void reserve(size_t n)
+				{
+					SparseSet::reserve(n);
+				}
+
+				void swap_at(size_t a, size_t b) override
+				{
+					if (a != b)
+						this->swap_positions(a, b);
+				}
+
+				void remove(EntIndex e) override
+				{
+					this->erase(e);
+				}
+			};
+
+			struct Slot
+			{ };
+
+			/// Match set of a CachedView, kept up to date by the Database.
+			struct Matcher
+			{
+				vector<GUID> required;
+				vector<GUID> excluded;
+				SparseSet set;
+
+				bool matches(Database const& db, EntIndex e) const
+				{
+					for (auto guid : required)
+					{
+						auto pool = db.pool_at(guid);
+						if (!pool || !pool->has(e))
+							return false;
+					}
+
+					for (auto guid : excluded)
+					{
+						auto pool = db.pool_at(guid);
+						if (pool && pool->has(e))
+							return false;
+					}
+
+					return true;
+				}
+			};
+
+			/*! Owning group.
+			 *
+			 * The Entities having every owned component sit at positions
+			 * [0, size) of each owned pool, in the same order.
+			 */
+			struct GroupData
+			{
+				vector<GUID> owned;
+				vector<PoolBase*> pools;
+				size_t size = 0;
+
+				bool owns(GUID guid) const
+				{
+					return find(begin(owned), end(owned), guid) != end(owned);
+				}
+
+				bool contains(EntIndex e) const
+				{
+					return pools[0]->has(e) && pools[0]->index(e) < size;
+				}
+
+				bool complete(EntIndex e) const
+				{
+					for (auto pool : pools)
+						if (!pool->has(e))
+							return false;
+
+					return true;
+				}
+
+				void enter(EntIndex e)
+				{
+					for (auto pool : pools)
+						pool->swap_at(pool->index(e), size);
+					++size;
+				}
+
+				void leave(EntIndex e)
+				{
+					--size;
+					for (auto pool : pools)
+						pool->swap_at(pool->index(e), size);
+				}
+			};
+
+			/*! Pools, by GUID.
+			 *
+			 * Open addressing on the GUID itself: GUIDs are already hashes, so
+			 * a lookup is a mask and usually a single compare.
+			 */
+			class PoolTable
+			{
+			public:
+				struct Entry
+				{
+					GUID guid = 0;
+					unique_ptr<PoolBase> pool;
+				};
+
+			private:
+				vector<Entry> entries;
+				size_t count = 0;
+
+				Entry& slot(GUID guid)
+				{
+					size_t mask = entries.size() - 1;
+					size_t i = size_t(guid) & mask;
+
+					while (entries[i].pool && entries[i].guid != guid)
+						i = (i + 1) & mask;
+
+					return entries[i];
+				}
+
+			public:
+				PoolBase* find(GUID guid) const
+				{
+					if (entries.empty())
+						return nullptr;
+
+					size_t mask = entries.size() - 1;
+					for (size_t i = size_t(guid) & mask; entries[i].pool; i = (i + 1) & mask)
+						if (entries[i].guid == guid)
+							return entries[i].pool.get();
+
+					return nullptr;
+				}
+
+				PoolBase* insert(GUID guid, unique_ptr<PoolBase> pool)
+				{
+					if ((count + 1) * 2 > entries.size())
+					{
+						vector<Entry> old(max<size_t>(16, entries.size() * 2));
+						swap(old, entries);
+
+						for (auto& entry : old)
+							if (entry.pool)
+								slot(entry.guid) = move(entry);
+					}
+
+					auto& entry = slot(guid);
+					entry.guid = guid;
+					entry.pool = move(pool);
+					++count;
+					return entry.pool.get();
+				}
+
+				typename vector<Entry>::const_iterator begin() const
+				{
+					return entries.begin();
+				}
+
+				typename vector<Entry>::const_iterator end() const
+				{
+					return entries.end();
+				}
+			};
+
+			PoolTable pools;
+			SlotTable<Slot, AllocatorT> slots;
+			Signals signals;
+			SparseSet living;
+			vector<Matcher*> matchers;
+			vector<unique_ptr<GroupData>> groups;
+
+			uint64_t change_tick = 0;
+			uint64_t structure_version = 0;
+
+			uint64_t stamp()
+			{
+				return ++change_tick;
+			}
+
+			PoolBase* pool_at(GUID guid) const
+			{
+				return pools.find(guid);
+			}
+
+			template<typename T>
+			Pool<T>* pool() const
+			{
+				return static_cast<Pool<T>*>(pools.find(getGUID<T>()));
+			}
+
+			template<typename T>
+			Pool<T>& assure()
+			{
+				if (auto pool = pools.find(getGUID<T>()))
+					return *static_cast<Pool<T>*>(pool);
+
+				return *static_cast<Pool<T>*>(pools.insert(getGUID<T>(), unique_ptr<PoolBase>(new Pool<T>())));
+			}
+
+		public:
+			/*! Component ID
+			 *
+			 * A handle to a type-erased component. Very lightweight.
+			 * Stays valid until the component itself is erased.
+			 */
+			class ComID
+			{
+				friend class Database;
+
+				Database* db = nullptr;
+				EntID eid;
+				GUID guid = 0;
+
+			public:
+				/*! Access component data.
+				 *
+				 * The specified type must match the component's real type,
+				 * otherwise behaviour is undefined.
+				 *
+				 * @tparam Explicit component data type.
+				 * @return Reference to component data.
+				 */
+				template<typename T>
+				T& cast() const
+				{
+					return db->template pool<T>()->get(eid.index());
+				}
+
+				/*! Get parent's EntID.
+				 *
+				 * @return Handle to parent Entity.
+				 */
+				EntID const& EID() const
+				{
+					return eid;
+				}
+
+				/*! Compares this ComID to another for equivalence.
+				 *
+				 * @param other The ComID to compare to this.
+				 * @return True if ComIDs are equivalent.
+				 */
+				bool operator==(ComID const& other) const
+				{
+					return db == other.db && eid == other.eid && guid == other.guid;
+				}
+
+				/*! Compares this ComID to another for ordering.
+				 *
+				 * @param other The ComID to compare to this.
+				 * @return True if this should be ordered before other.
+				 */
+				bool operator<(ComID const& other) const
+				{
+					return tie(db, eid, guid) < tie(other.db, other.eid, other.guid);
+				}
+			};
+
+			/*! Component Info
+			 *
+			 * A handle to a component of known type.
+			 * Provides direct access to the component,
+			 * as well as its ComID.
+			 *
+			 * @tparam Com Component type.
+			 */
+			template<typename Com>
+			class ComInfo
+			{
+				friend class Database;
+
+				Com* ptr = nullptr;
+				ComID cid;
+
+				ComInfo(Pool<Com>* pool, EntIndex e, ComID i) : ptr(&pool->get(e)), cid(i)
+				{ }
+
+			public:
+				using type = Com;
+
+				ComInfo() = default;
+
+				/*! Test for validity.
+				 *
+				 * @return True if valid.
+				 */
+				explicit operator bool() const
+				{
+					return ptr != nullptr;
+				}
+
+				/*! Get component.
+				 *
+				 * @warning
+				 * Behaviour is undefined if this ComInfo is invalid.
+				 *
+				 * @return The component.
+				 */
+				Com& data() const
+				{
+					return *ptr;
+				}
+
+				/*! Get component ID.
+				 *
+				 * @warning
+				 * Behaviour is undefined if this ComInfo is invalid.
+				 *
+				 * @return A ComID handle for this component.
+				 */
+				ComID const& id() const
+				{
+					return cid;
+				}
+			};
+
+			/*! Component Info for Tags
+			 *
+			 * A handle to a component of known type.
+			 * Provides the component's ComID.
+			 *
+			 * @tparam Com Component type.
+			 */
+			template<typename Com>
+			class ComInfo<Tag<Com>>
+			{
+				friend class Database;
+
+				bool is_valid = false;
+				ComID cid;
+
+				ComInfo(Pool<Tag<Com>>*, EntIndex, ComID i) : is_valid(true), cid(i)
+				{ }
+
+			public:
+				using type = Com;
+
+				ComInfo() = default;
+
+				/*! Test for validity.
+				 *
+				 * @return True if valid.
+				 */
+				explicit operator bool() const
+				{
+					return is_valid;
+				}
+
+				/*! Get component ID.
+				 *
+				 * @warning
+				 * Behaviour is undefined if this ComInfo is invalid.
+				 *
+				 * @return A ComID handle for this component.
+				 */
+				ComID const& id() const
+				{
+					return cid;
+				}
+			};
+
+			Database() = default;
+
+			Database(Database const&) = delete;
+
+			Database& operator=(Database const&) = delete;
+
+			// Entity functions
+
+			/*! Creates a new Entity.
+			 *
+			 * Creates a new Entity that has no components.
+			 *
+			 * @return EntID of the new Entity.
+			 */
+			EntID create_entity()
+			{
+				EntID rv = slots.emplace();
+				living.insert(rv.index());
+				++structure_version;
+
+				for (auto matcher : matchers)
+					if (matcher->required.empty())
+						matcher->set.insert(rv.index());
+
+				return rv;
+			}
+
+			/*! Creates several Entities at once.
+			 *
+			 * Creates n Entities, each with a copy of the given components.
+			 * Every pool involved grows once, up front.
+			 *
+			 * @param n Number of Entities to create.
+			 * @param coms Component values, of distinct types.
+			 * @return EntIDs of the new Entities.
+			 */
+			template<typename... Ts>
+			vector<EntID> create_entities(size_t n, Ts const& ... coms)
+			{
+				static_assert(ListUnique<TypeList<Ts...>>::value, "Component types must be distinct");
+
+				vector<EntID> rv;
+				rv.reserve(n);
+				slots.reserve(n);
+				living.reserve(n);
+				(void) initializer_list<int>{(assure<Ts>().reserve(n), 0)...};
+
+				uint64_t tick = stamp();
+				(void) tick;
+
+				for (size_t i = 0; i < n; ++i)
+				{
+					EntID eid = create_entity();
+					(void) initializer_list<int>{(add_component(assure<Ts>(), eid.index(), coms, tick), 0)...};
+					rv.push_back(eid);
+				}
+
+				return rv;
+			}
+
+			/*! Destroys an Entity.
+			 *
+			 * Destroys the given Entity and all associated components.
+			 * Does nothing if the EntID is dangling.
+			 *
+			 * @warning
+			 * All components associated with the Entity are destroyed.
+			 * This means that all references and ComIDs associated with those
+			 * components are invalidated.
+			 *
+			 * @param eid EntID of the Entity to erase.
+			 */
+			void erase_entity(EntID eid)
+			{
+				if (!valid(eid))
+					return;
+
+				for (auto& entry : pools)
+				{
+					if (entry.pool && entry.pool->has(eid.index()))
+					{
+						signals.emit(entry.guid, Signal::destroy, eid);
+						leave_groups(entry.guid, eid.index());
+						entry.pool->remove(eid.index());
+					}
+				}
+
+				for (auto matcher : matchers)
+					if (matcher->set.has(eid.index()))
+						matcher->set.erase(eid.index());
+
+				living.erase(eid.index());
+				slots.erase(eid);
+				++structure_version;
+			}
+
+			/*! Test an EntID.
+			 *
+			 * @param eid EntID to test.
+			 * @return True if the EntID refers to a living Entity.
+			 */
+			bool valid(EntID eid) const
+			{
+				return slots.alive(eid);
+			}
+
+			/*! Query an Entity for a component.
+			 *
+			 * Queries the Entity for the given component type.
+			 * If found, returns a valid ComInfo object for the requested
+			 * component.
+			 * Otherwise, or if the EntID is dangling, returns an invalid ComInfo
+			 * object.
+			 *
+			 * @tparam T Explicit type of component.
+			 * @param eid Entity to query.
+			 * @return ComInfo for the requested component.
+			 */
+			template<typename T>
+			ComInfo<T> get(EntID eid) const
+			{
+				auto pool = this->template pool<T>();
+
+				if (!pool || !pool->has(eid.index()) || !slots.alive(eid))
+					return {};
+
+				ComID cid;
+				cid.db = const_cast<Database*>(this);
+				cid.eid = eid;
+				cid.guid = getGUID<T>();
+				return {pool, eid.index(), cid};
+			}
+
+			/*! Query an Entity for multiple components.
+			 *
+			 * Returns a tuple containing results equivalent to multiple
+			 * calls to get().
+			 *
+			 * @tparam Ts Explicit component types.
+			 * @param eid Entity to query.
+			 * @return Tuple of results equivalent to get().
+			 */
+			template<typename... Ts>
+			tuple<ComInfo<Ts>...> coms(EntID eid) const
+			{
+				return make_tuple(get<Ts>(eid)...);
+			}
+
+			// Component functions
+
+			/*! Create new component.
+			 *
+			 * Creates a new component from the given value and associates it with
+			 * the given Entity.
+			 * If a component of the same type already exists, it will be
+			 * overwritten.
+			 *
+			 * @warning
+			 * References to components of the same type may be invalidated.
+			 *
+			 * @param eid Entity to attach new component to.
+			 * @param com Component value.
+			 * @return ComInfo for the new component.
+			 */
+			template<typename T>
+			ComInfo<T> create_component(EntID eid, T com)
+			{
+				assert(valid(eid) && "Dangling EntID");
+				auto& pool = assure<T>();
+				add_component(pool, eid.index(), move(com), stamp());
+
+				ComID cid;
+				cid.db = this;
+				cid.eid = eid;
+				cid.guid = getGUID<T>();
+				return {&pool, eid.index(), cid};
+			}
+
+			/*! Create a component on several Entities.
+			 *
+			 * Equivalent to calling create_component() with each EntID and
+			 * the value at the same position, but the pool grows only once.
+			 *
+			 * @warning
+			 * References to components of the same type may be invalidated.
+			 *
+			 * @param eids Entities to attach the components to.
+			 * @param coms Component values, one per Entity.
+			 * @param count Number of Entities.
+			 */
+			template<typename T>
+			void create_components(EntID const* eids, T const* coms, size_t count)
+			{
+				auto& pool = assure<T>();
+				pool.reserve(count);
+
+				uint64_t tick = stamp();
+
+				for (size_t i = 0; i < count; ++i)
+				{
+					assert(valid(eids[i]) && "Dangling EntID");
+					add_component(pool, eids[i].index(), coms[i], tick);
+				}
+			}
+
+			/*! Erase a component.
+			 *
+			 * Destroys the given component and disassociates it from its Entity.
+			 *
+			 * @warning
+			 * The last component of the same type is moved in place of the erased
+			 * one. References to it are invalidated.
+			 *
+			 * @param cid ComID of the component to erase.
+			 */
+			void erase_component(ComID cid)
+			{
+				auto pool = pool_at(cid.guid);
+
+				if (pool && pool->has(cid.eid.index()))
+				{
+					signals.emit(cid.guid, Signal::destroy, cid.eid);
+					leave_groups(cid.guid, cid.eid.index());
+					pool->remove(cid.eid.index());
+					component_removed(cid.guid, cid.eid.index());
+					++structure_version;
+				}
+			}
+
+			/*! Visit the Database.
+			 *
+			 * Calls the visitor once for each Entity that matches the visitor's
+			 * parameters. The smallest pool among the requested components drives
+			 * the iteration; the other pools are only probed for its Entities, so
+			 * the cost is proportional to the rarest component. Not<> parameters
+			 * never drive. The driving component is read from its dense array
+			 * directly.
+			 *
+			 * @warning
+			 * Creating or erasing components or Entities during a visit is
+			 * undefined behaviour. Record them in a CommandBuffer and flush it
+			 * after the visit instead.
+			 *
+			 * @param visitor Visitor to call.
+			 */
+			template<typename Visitor>
+			void visit(Visitor&& visitor)
+			{
+				visit(std::forward<Visitor>(visitor), 0);
+			}
+
+			template<typename Visitor>
+			void visit(Visitor&& visitor) const
+			{
+				const_cast<Database&>(*this).visit(std::forward<Visitor>(visitor));
+			}
+
+			/*! Visit the Database for changes.
+			 *
+			 * Equivalent to visit(), but `Changed<T>` parameters only match the
+			 * Entities whose T was created or written after the given tick.
+			 * Keep the value of tick() from the previous run to visit what
+			 * changed since then.
+			 *
+			 * The components visited through `T&` or `ComInfo<T>` parameters are
+			 * marked as changed.
+			 *
+			 * @param visitor Visitor to call.
+			 * @param since Change tick.
+			 */
+			template<typename Visitor>
+			void visit(Visitor&& visitor, uint64_t since)
+			{
+				using Traits = VisitorTraits<Database, Visitor>;
+				ProfileScope profile("ginseng::visit");
+				visit_impl(visitor, since, index_sequence_for_list(typename Traits::components{}), typename Traits::parameters{}, typename Traits::components{});
+			}
+
+			/*! Visit the Database in parallel.
+			 *
+			 * Equivalent to visit(), but the dense array of the driving pool is
+			 * split in ranges of about grain Entities, which are visited
+			 * concurrently by the given executor. The executor must provide
+			 * `parallel_for(count, grain, f)`, calling `f(begin, end)` over
+			 * `[0, count)`.
+			 *
+			 * Each Entity is visited by exactly one thread, so writing to the
+			 * visited components is safe. The visitor is shared by every
+			 * thread: its call operator must be const, and it must not take
+			 * ComInfo parameters.
+			 *
+			 * @param executor Executor running the ranges.
+			 * @param visitor Visitor to call.
+			 * @param grain Approximate number of Entities per range.
+			 * @param since Change tick, as for visit().
+			 */
+			template<typename Executor, typename Visitor>
+			void parallel_visit(Executor& executor, Visitor&& visitor, size_t grain = 1024, uint64_t since = 0)
+			{
+				using Traits = VisitorTraits<Database, Visitor>;
+				static_assert(ParallelVisitCheck<Database, Visitor>::value, "");
+				ProfileScope profile("ginseng::parallel_visit");
+
+				parallel_visit_impl(executor, visitor, grain, since, index_sequence_for_list(typename Traits::components{}), typename Traits::parameters{}, typename Traits::components{});
+			}
+
+			// query
+
+			/*! Create a View of the Database.
+			 *
+			 * Returns a lazy range over the Entities matching the given
+			 * parameters, which follow the same rules as visitor parameters.
+			 * Usable with range-for and the standard algorithms. Like visit(),
+			 * iteration is driven by the smallest pool.
+			 *
+			 * `Changed<T>` parameters only match the components changed after
+			 * the given tick. Writes through a View are not tracked; use touch().
+			 *
+			 * @tparam Ts View parameters.
+			 * @param since Change tick.
+			 * @return View of the matching Entities.
+			 */
+			template<typename... Ts>
+			View<Ts...> view(uint64_t since = 0)
+			{
+				View<Ts...> rv;
+				rv.db = this;
+
+				if (auto driver = prepare(rv.probes, since, index_sequence_for<Ts...>{}))
+				{
+					rv.entities = driver->entities();
+					rv.count = driver->size();
+				}
+
+				return rv;
+			}
+
+			/*! Create a cached View of the Database.
+			 *
+			 * Like view(), but the matching Entities are kept in a set of their
+			 * own, which the Database updates as components are created and
+			 * erased. Iterating it tests nothing.
+			 *
+			 * @tparam Ts View parameters.
+			 * @return Cached View of the matching Entities.
+			 */
+			template<typename... Ts>
+			CachedView<Ts...> cached_view()
+			{
+				unique_ptr<Matcher> matcher(new Matcher);
+				(void) initializer_list<int>{(add_to_matcher<decay_t<Ts>>(*matcher, typename ComponentTraits<Database, decay_t<Ts>>::tag{}), 0)...};
+
+				SparseSet const* driver = &living;
+				for (auto guid : matcher->required)
+				{
+					auto pool = pool_at(guid);
+					if (!pool)
+					{
+						driver = nullptr;
+						break;
+					}
+					if (pool->size() < driver->size())
+						driver = pool;
+				}
+
+				if (driver)
+				{
+					auto entities = driver->entities();
+					for (size_t i = 0, e = driver->size(); i < e; ++i)
+						if (matcher->matches(*this, entities[i]))
+							matcher->set.insert(entities[i]);
+				}
+
+				matchers.push_back(matcher.get());
+				return {this, move(matcher)};
+			}
+
+			/*! Get an owning Group.
+			 *
+			 * From now on, the Entities having every one of the given
+			 * components are kept at the front of their pools, in the same
+			 * order, and the Group iterates them as plain arrays. Asking again
+			 * for the same components returns the same Group.
+			 *
+			 * Keeping a group costs a few swaps whenever an Entity enters or
+			 * leaves it.
+			 *
+			 * @warning
+			 * A component type can be owned by a single Group.
+			 *
+			 * @tparam Ts Owned component types, distinct and not Tags.
+			 * @return Group of the Entities having every component.
+			 */
+			template<typename... Ts>
+			Group<Ts...> group()
+			{
+				static_assert(sizeof...(Ts) > 0, "A Group owns at least one component");
+				static_assert(ListUnique<TypeList<Ts...>>::value, "Component types must be distinct");
+
+				vector<GUID> owned = {getGUID<Ts>()...};
+				std::sort(begin(owned), end(owned));
+
+				for (auto& group : groups)
+					if (group->owned == owned)
+						return {this, group.get()};
+
+				unique_ptr<GroupData> group(new GroupData);
+				group->owned = move(owned);
+				group->pools = {&assure<Ts>()...};
+
+				for (auto guid : group->owned)
+				{
+					(void) guid;
+					assert(!group_owning(guid) && "Component already owned by another Group");
+				}
+
+				auto driver = *min_element(begin(group->pools), end(group->pools), [](PoolBase* a, PoolBase* b)
+				{
+					return a->size() < b->size();
+				});
+
+				// Entering only swaps with positions before the current one
+				for (size_t i = 0; i < driver->size(); ++i)
+				{
+					EntIndex e = driver->entities()[i];
+					if (group->complete(e))
+						group->enter(e);
+				}
+
+				groups.push_back(move(group));
+				++structure_version;
+				return {this, groups.back().get()};
+			}
+
+			/*! Sort the components of a type.
+			 *
+			 * Reorders the pool in place, with an insertion sort: cheap when
+			 * the order barely changed since the last sort. Visits driven by
+			 * this pool, and Groups owning it, follow the new order.
+			 *
+			 * If the type is owned by a Group, the Group part and the rest of
+			 * the pool are sorted separately, and the other pools of the Group
+			 * follow.
+			 *
+			 * @warning
+			 * References to components of the given type are invalidated.
+			 *
+			 * @tparam T Explicit type of component.
+			 * @param cmp Strict weak ordering of `T const&`.
+			 */
+			template<typename T, typename Compare>
+			void sort(Compare cmp)
+			{
+				auto pool = this->template pool<T>();
+				if (!pool)
+					return;
+
+				auto group = group_owning(getGUID<T>());
+				size_t split = group ? group->size : 0;
+				++structure_version;
+
+				if (group)
+				{
+					insertion_sort(*pool, 0, split, cmp, [&](size_t a, size_t b)
+					{
+						for (auto owned : group->pools)
+							owned->swap_at(a, b);
+					});
+				}
+
+				insertion_sort(*pool, split, pool->size(), cmp, [&](size_t a, size_t b)
+				{
+					pool->swap_at(a, b);
+				});
+			}
+
+			/*! Query the Database.
+			 *
+			 * Queries the Database for Entities that match the given template parameters.
+			 *
+			 * Returns a `std::vector<std::tuple<Ts...>>` where each element is a tuple of values filled by calling
+			 * `visit([](Ts...){})` and forwarding the visitor's parameters to each tuple.
+			 * Prefer view(), which does not allocate.
+			 *
+			 * @tparam Ts Query parameters.
+			 * @return Query results.
+			 */
+			template<typename... Ts>
+			std::vector<std::tuple<Ts...>> query()
+			{
+				auto v = view<Ts...>();
+				return std::vector<std::tuple<Ts...>>(v.begin(), v.end());
+			}
+
+			// status functions
+			size_t size() const
+			{
+				return living.size();
+			}
+
+			/*! Number of components of a type.
+			 *
+			 * @tparam T Component type.
+			 * @return Number of Entities that have a T.
+			 */
+			template<typename T>
+			size_t count() const
+			{
+				auto pool = this->template pool<T>();
+				return pool ? pool->size() : 0;
+			}
+
+			/*! Release unused memory.
+			 *
+			 * Pools never leave holes, since erasing moves the last component
+			 * of the pool into the freed position. After a peak, compact()
+			 * shrinks every pool to its current size and frees the pages of
+			 * the sparse arrays that no longer hold any Entity.
+			 *
+			 * @warning
+			 * Components are moved. References to components are invalidated.
+			 */
+			void compact()
+			{
+				for (auto& entry : pools)
+					if (entry.pool)
+						entry.pool->shrink();
+
+				living.shrink();
+
+				for (auto matcher : matchers)
+					matcher->set.shrink();
+
+				++structure_version;
+			}
+
+			/*! Current change tick.
+			 *
+			 * Every change is stamped with a tick greater than the current one.
+			 *
+			 * @return Current change tick.
+			 */
+			uint64_t tick() const
+			{
+				return change_tick;
+			}
+
+			/*! Structure version.
+			 *
+			 * Changes whenever Entities or components are created or erased,
+			 * or components move in memory, as pools grow, shrink, or are
+			 * reordered by sort() and Groups. While it stays the same,
+			 * pointers to components remain valid, and so does the absence of
+			 * a component.
+			 *
+			 * @return Structure version.
+			 */
+			uint64_t version() const
+			{
+				return structure_version;
+			}
+
+			/*! Mark a component as changed.
+			 *
+			 * For writes the Database cannot see, such as writes through get()
+			 * or a View.
+			 *
+			 * @tparam T Explicit type of component.
+			 * @param eid Entity owning the component.
+			 */
+			template<typename T>
+			void touch(EntID eid)
+			{
+				auto pool = this->template pool<T>();
+
+				if (pool && pool->has(eid.index()) && slots.alive(eid))
+				{
+					pool->tick_at(pool->index(eid.index())) = stamp();
+					signals.emit(getGUID<T>(), Signal::update, eid);
+				}
+			}
+
+			// Signals
+
+			/*! Listen to component creation.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities that gained a T since the previous dispatch().
+			 *
+			 * @tparam T Component type, which may be a Tag.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_construct(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::construct, std::forward<Func>(func));
+			}
+
+			/*! Listen to component updates.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities whose T was overwritten by create_component() or
+			 * marked by touch() since the previous dispatch(). Writes through
+			 * visitors, Views or get() are not signaled.
+			 *
+			 * @tparam T Component type.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_update(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::update, std::forward<Func>(func));
+			}
+
+			/*! Listen to component destruction.
+			 *
+			 * dispatch() calls the listener as `func(EntID const* eids, size_t count)`
+			 * with the Entities that lost their T, or were erased, since the
+			 * previous dispatch(). Erased Entities are no longer valid by then.
+			 *
+			 * @tparam T Component type, which may be a Tag.
+			 * @param func Listener.
+			 * @return ID of the listener, for disconnect().
+			 */
+			template<typename T, typename Func>
+			SignalID on_destroy(Func&& func)
+			{
+				return signals.connect(getGUID<T>(), Signal::destroy, std::forward<Func>(func));
+			}
+
+			/*! Remove a listener.
+			 *
+			 * @param sid ID returned when connecting the listener.
+			 */
+			void disconnect(SignalID sid)
+			{
+				signals.disconnect(sid);
+			}
+
+			/*! Deliver the queued component events.
+			 *
+			 * The sync point of the signals: each listener is called once per
+			 * dispatch at most, with every event of its type and kind since the
+			 * previous dispatch. An Entity appears once per event, so it may
+			 * appear several times, or be gone already.
+			 *
+			 * Listeners may change the Database; the events they cause are
+			 * delivered by the next dispatch.
+			 */
+			void dispatch()
+			{
+				signals.dispatch();
+			}
+
+		private:
+			// Visit
+
+			template<typename... Coms>
+			static index_sequence_for<Coms...> index_sequence_for_list(TypeList<Coms...>)
+			{
+				return {};
+			}
+
+			template<typename Com, typename TagT = typename ComponentTraits<Database, Com>::tag>
+			class Probe;
+
+			template<typename Com>
+			class Probe<Com, ComponentTags::normal>
+			{
+				Pool<Com>* pool = nullptr;
+				Com* dense = nullptr;
+				uint64_t tick = 0;
+
+			public:
+				static constexpr bool required = true;
+
+				bool init(Database& db, uint64_t)
+				{
+					pool = db.template pool<Com>();
+					return pool != nullptr;
+				}
+
+				PoolBase* set() const
+				{
+					return pool;
+				}
+
+				void drive()
+				{
+					dense = pool->data();
+				}
+
+				bool test(EntIndex e) const
+				{
+					return dense || pool->has(e);
+				}
+
+				void write(uint64_t t)
+				{
+					tick = t;
+				}
+
+				Com& get(Database&, EntIndex e, size_t i) const
+				{
+					size_t pos = dense ? i : pool->index(e);
+					if (tick)
+						pool->tick_at(pos) = tick;
+					return pool->data()[pos];
+				}
+			};
+
+			template<typename Com>
+			class Probe<Com, ComponentTags::tagged>
+			{
+				Pool<Com>* pool = nullptr;
+
+			public:
+				static constexpr bool required = true;
+
+				bool init(Database& db, uint64_t)
+				{
+					pool = db.template pool<Com>();
+					return pool != nullptr;
+				}
+
+				PoolBase* set() const
+				{
+					return pool;
+				}
+
+				void drive()
+				{ }
+
+				bool test(EntIndex e) const
+				{
+					return pool->has(e);
+				}
+
+				void write(uint64_t)
+				{ }
+
+				Com get(Database&, EntIndex, size_t) const
+				{
+					return {};
+				}
+			};
+
+			template<typename Com>
+			class Probe<Com, ComponentTags::inverted>
+			{
+				using Traits = ComponentTraits<Database, Com>;
+
+				Pool<typename Traits::com>* pool = nullptr;
+
+			public:
+				static constexpr bool required = false;
+
+				bool init(Database& db, uint64_t)
+				{
+					pool = db.template pool<typename Traits::com>();
+					return true;
+				}
+
+				PoolBase* set() const
+				{
+					return nullptr;
+				}
+
+				void drive()
+				{ }
+
+				bool test(EntIndex e) const
+				{
+					return !pool || !pool->has(e);
+				}
+
+				void write(uint64_t)
+				{ }
+
+				Not<typename Traits::com> get(Database&, EntIndex, size_t) const
+				{
+					return {};
+				}
+			};
+
+			template<typename Com>
+			class Probe<Com, ComponentTags::info>
+			{
+				using Traits = ComponentTraits<Database, Com>;
+
+				Pool<typename Traits::com>* pool = nullptr;
+				uint64_t tick = 0;
+
+			public:
+				static constexpr bool required = true;
+
+				bool init(Database& db, uint64_t)
+				{
+					pool = db.template pool<typename Traits::com>();
+					return pool != nullptr;
+				}
+
+				PoolBase* set() const
+				{
+					return pool;
+				}
+
+				void drive()
+				{ }
+
+				bool test(EntIndex e) const
+				{
+					return pool->has(e);
+				}
+
+				void write(uint64_t t)
+				{
+					tick = t;
+				}
+
+				Com get(Database& db, EntIndex e, size_t) const
+				{
+					if (tick)
+						pool->tick_at(pool->index(e)) = tick;
+
+					ComID cid;
+					cid.db = &db;
+					cid.eid = db.slots.id_at(e);
+					cid.guid = getGUID<typename Traits::com>();
+					return {pool, e, cid};
+				}
+			};
+
+			template<typename Com>
+			class Probe<Com, ComponentTags::changed>
+			{
+				using Traits = ComponentTraits<Database, Com>;
+
+				Pool<typename Traits::com>* pool = nullptr;
+				uint64_t since = 0;
+
+			public:
+				static constexpr bool required = true;
+
+				bool init(Database& db, uint64_t s)
+				{
+					pool = db.template pool<typename Traits::com>();
+					since = s;
+					return pool != nullptr;
+				}
+
+				PoolBase* set() const
+				{
+					return pool;
+				}
+
+				void drive()
+				{ }
+
+				bool test(EntIndex e) const
+				{
+					return pool->has(e) && pool->tick_at(pool->index(e)) > since;
+				}
+
+				void write(uint64_t)
+				{ }
+
+				Changed<typename Traits::com> get(Database&, EntIndex, size_t) const
+				{
+					return {};
+				}
+			};
+
+			template<typename Com>
+			class Probe<Com, ComponentTags::eid>
+			{
+			public:
+				static constexpr bool required = false;
+
+				bool init(Database&, uint64_t)
+				{
+					return true;
+				}
+
+				PoolBase* set() const
+				{
+					return nullptr;
+				}
+
+				void drive()
+				{ }
+
+				bool test(EntIndex) const
+				{
+					return true;
+				}
+
+				void write(uint64_t)
+				{ }
+
+				EntID get(Database& db, EntIndex e, size_t) const
+				{
+					return db.slots.id_at(e);
+				}
+			};
+
+			template<typename Visitor, size_t... Is, typename... Params, typename... Coms>
+			void visit_impl(Visitor& visitor, uint64_t since, index_sequence<Is...> seq, TypeList<Params...> params, TypeList<Coms...>)
+			{
+				tuple<Probe<Coms>...> probes;
+
+				if (auto driver = prepare(probes, since, seq))
+				{
+					mark_writes(probes, params, seq);
+					visit_range(visitor, probes, driver->entities(), 0, driver->size(), seq);
+				}
+			}
+
+			template<typename Executor, typename Visitor, size_t... Is, typename... Params, typename... Coms>
+			void parallel_visit_impl(Executor& executor, Visitor& visitor, size_t grain, uint64_t since, index_sequence<Is...> seq, TypeList<Params...> params, TypeList<Coms...>)
+			{
+				tuple<Probe<Coms>...> probes;
+
+				if (auto driver = prepare(probes, since, seq))
+				{
+					mark_writes(probes, params, seq);
+
+					auto entities = driver->entities();
+					executor.parallel_for(driver->size(), grain, [&](size_t first, size_t last)
+					{
+						visit_range(visitor, probes, entities, first, last, seq);
+					});
+				}
+			}
+
+			/// Initializes the probes and returns the set driving the
+			/// iteration, or nullptr if no Entity can match.
+			template<typename Probes, size_t... Is>
+			SparseSet const* prepare(Probes& probes, uint64_t since, index_sequence<Is...>)
+			{
+				// A missing pool means no Entity can match
+				bool ready = true;
+				(void) initializer_list<int>{(ready = ready && std::get<Is>(probes).init(*this, since), 0)...};
+				if (!ready)
+					return nullptr;
+
+				// The smallest pool among the required components drives the
+				// iteration, the others are only probed for its Entities
+				SparseSet const* driver = &living;
+				size_t best = numeric_limits<size_t>::max();
+				(void) initializer_list<int>{(select_driver(std::get<Is>(probes), Is, driver, best), 0)...};
+				(void) initializer_list<int>{(Is == best ? std::get<Is>(probes).drive() : (void) 0, 0)...};
+
+				return driver;
+			}
+
+			template<typename Visitor, typename Probes, size_t... Is>
+			void visit_range(Visitor& visitor, Probes const& probes, EntIndex const* entities, size_t first, size_t last, index_sequence<Is...>)
+			{
+				for (size_t i = first; i < last; ++i)
+				{
+					EntIndex ent = entities[i];
+
+					bool matches = true;
+					(void) initializer_list<int>{(matches = matches && std::get<Is>(probes).test(ent), 0)...};
+
+					if (matches)
+						visitor(std::get<Is>(probes).get(*this, ent, i)...);
+				}
+			}
+
+			template<typename Probes, size_t... Is>
+			void init_probes(Probes& probes, index_sequence<Is...>)
+			{
+				(void) initializer_list<int>{(std::get<Is>(probes).init(*this, 0), 0)...};
+			}
+
+			/// Makes the probes of written parameters mark what they visit.
+			template<typename Probes, typename... Params, size_t... Is>
+			void mark_writes(Probes& probes, TypeList<Params...>, index_sequence<Is...>)
+			{
+				bool written[] = {!is_same<typename ParamAccess<Database, Params>::writes, TypeList<>>::value..., false};
+
+				if (find(begin(written), end(written), true) == end(written))
+					return;
+
+				uint64_t tick = stamp();
+				(void) initializer_list<int>{(std::get<Is>(probes).write(written[Is] ? tick : 0), 0)...};
+			}
+
+			template<typename P>
+			static void select_driver(P const& probe, size_t index, SparseSet const*& driver, size_t& best)
+			{
+				if (!P::required)
+					return;
+
+				SparseSet const* set = probe.set();
+				if (best == numeric_limits<size_t>::max() || set->size() < driver->size())
+				{
+					driver = set;
+					best = index;
+				}
+			}
+
+			// Cached views
+
+			template<typename T, typename TagT>
+			static void add_to_matcher(Matcher& matcher, TagT)
+			{
+				matcher.required.push_back(getGUID<typename ComponentTraits<Database, T>::com>());
+			}
+
+			template<typename T>
+			static void add_to_matcher(Matcher& matcher, ComponentTags::inverted)
+			{
+				matcher.excluded.push_back(getGUID<typename ComponentTraits<Database, T>::com>());
+			}
+
+			template<typename T>
+			static void add_to_matcher(Matcher&, ComponentTags::eid)
+			{ }
+
+			template<typename T>
+			void add_component(Pool<T>& pool, EntIndex e, T com, uint64_t tick)
+			{
+				bool added = !pool.has(e);
+				pool.emplace(e, move(com), tick);
+
+				if (added)
+				{
+					component_added(getGUID<T>(), e);
+					++structure_version;
+				}
+
+				if (signals.observed(added ? Signal::construct : Signal::update))
+					signals.emit(getGUID<T>(), added ? Signal::construct : Signal::update, slots.id_at(e));
+			}
+
+			void component_added(GUID guid, EntIndex e)
+			{
+				for (auto& group : groups)
+					if (group->owns(guid) && !group->contains(e) && group->complete(e))
+						group->enter(e);
+
+				for (auto matcher : matchers)
+				{
+					if (find(begin(matcher->required), end(matcher->required), guid) != end(matcher->required))
+					{
+						if (!matcher->set.has(e) && matcher->matches(*this, e))
+							matcher->set.insert(e);
+					}
+					else if (find(begin(matcher->excluded), end(matcher->excluded), guid) != end(matcher->excluded))
+					{
+						if (matcher->set.has(e))
+							matcher->set.erase(e);
+					}
+				}
+			}
+
+			/// Called before a component is removed from its pool.
+			void leave_groups(GUID guid, EntIndex e)
+			{
+				for (auto& group : groups)
+					if (group->owns(guid) && group->contains(e))
+						group->leave(e);
+			}
+
+			GroupData* group_owning(GUID guid) const
+			{
+				for (auto& group : groups)
+					if (group->owns(guid))
+						return group.get();
+
+				return nullptr;
+			}
+
+			/// Insertion sort of the dense range [first, last) of a pool.
+			template<typename T, typename Compare, typename Swap>
+			static void insertion_sort(Pool<T>& pool, size_t first, size_t last, Compare& cmp, Swap swap_at)
+			{
+				for (size_t i = first + 1; i < last; ++i)
+					for (size_t j = i; j > first && cmp(pool.data()[j], pool.data()[j - 1]); --j)
+						swap_at(j, j - 1);
+			}
+
+			void component_removed(GUID guid, EntIndex e)
+			{
+				for (auto matcher : matchers)
+				{
+					if (find(begin(matcher->required), end(matcher->required), guid) != end(matcher->required))
+					{
+						if (matcher->set.has(e))
+							matcher->set.erase(e);
+					}
+					else if (find(begin(matcher->excluded), end(matcher->excluded), guid) != end(matcher->excluded))
+					{
+						if (!matcher->set.has(e) && matcher->matches(*this, e))
+							matcher->set.insert(e);
+					}
+				}
+			}
+
+		public:
+			// Views
+
+			/*! View
+			 *
+			 * A lazy range over the Entities matching a set of parameters,
+			 * following the same rules as visitor parameters. Each element is a
+			 * `std::tuple<Ts...>` of references (or values) to the components.
+			 *
+			 * Iteration does not allocate. A View is invalidated by creating or
+			 * erasing components or Entities.
+			 *
+			 * @tparam Ts View parameters.
+			 */
+			template<typename... Ts>
+			class View
+			{
+				friend class Database;
+
+				template<typename...>
+				friend class CachedView;
+
+				Database* db = nullptr;
+				tuple<Probe<decay_t<Ts>>...> probes;
+				EntIndex const* entities = nullptr;
+				size_t count = 0;
+
+				/// False if every Entity of the driving set matches.
+				bool filtered = true;
+
+				template<size_t... Is>
+				bool test(EntIndex e, index_sequence<Is...>) const
+				{
+					bool matches = true;
+					(void) initializer_list<int>{(matches = matches && std::get<Is>(probes).test(e), 0)...};
+					return matches;
+				}
+
+			public:
+				View() = default;
+
+				class iterator
+				{
+					friend class View;
+
+					View const* view = nullptr;
+					size_t i = 0;
+
+					iterator(View const* v, size_t first) : view(v), i(first)
+					{
+						skip();
+					}
+
+					void skip()
+					{
+						if (view->filtered)
+							while (i < view->count && !view->test(view->entities[i], index_sequence_for<Ts...>{}))
+								++i;
+					}
+
+					template<size_t... Is>
+					tuple<Ts...> get(index_sequence<Is...>) const
+					{
+						EntIndex ent = view->entities[i];
+						return tuple<Ts...>(std::get<Is>(view->probes).get(*view->db, ent, i)...);
+					}
+
+				public:
+					using iterator_category = input_iterator_tag;
+					using value_type = tuple<Ts...>;
+					using difference_type = ptrdiff_t;
+					using pointer = void;
+					using reference = tuple<Ts...>;
+
+					iterator() = default;
+
+					reference operator*() const
+					{
+						return get(index_sequence_for<Ts...>{});
+					}
+
+					iterator& operator++()
+					{
+						++i;
+						skip();
+						return *this;
+					}
+
+					iterator operator++(int)
+					{
+						iterator rv = *this;
+						++*this;
+						return rv;
+					}
+
+					bool operator==(iterator const& other) const
+					{
+						return i == other.i;
+					}
+
+					bool operator!=(iterator const& other) const
+					{
+						return i != other.i;
+					}
+				};
+
+				iterator begin() const
+				{
+					return {this, 0};
+				}
+
+				iterator end() const
+				{
+					return {this, count};
+				}
+			};
+
+			/*! Cached View
+			 *
+			 * A View over a set of matching Entities owned by the Database and
+			 * updated incrementally whenever a watched component is created or
+			 * erased, so it can be kept across frames and iterated without any
+			 * test.
+			 *
+			 * The Database must outlive the CachedView.
+			 *
+			 * @tparam Ts View parameters.
+			 */
+			template<typename... Ts>
+			class CachedView
+			{
+				friend class Database;
+
+				Database* db = nullptr;
+				unique_ptr<Matcher> matcher;
+				View<Ts...> current;
+
+				CachedView(Database* d, unique_ptr<Matcher> m) : db(d), matcher(move(m))
+				{ }
+
+				void refresh()
+				{
+					current.db = db;
+					current.filtered = false;
+					current.entities = matcher->set.entities();
+					current.count = matcher->set.size();
+					db->init_probes(current.probes, index_sequence_for<Ts...>{});
+				}
+
+				void reset()
+				{
+					if (matcher)
+					{
+						auto& list = db->matchers;
+						list.erase(find(list.begin(), list.end(), matcher.get()));
+						matcher.reset();
+					}
+				}
+
+			public:
+				using iterator = typename View<Ts...>::iterator;
+
+				CachedView() = default;
+
+				CachedView(CachedView&&) = default;
+
+				CachedView& operator=(CachedView&& other)
+				{
+					if (this != &other)
+					{
+						reset();
+						db = other.db;
+						matcher = move(other.matcher);
+					}
+					return *this;
+				}
+
+				~CachedView()
+				{
+					reset();
+				}
+
+				iterator begin()
+				{
+					refresh();
+					return current.begin();
+				}
+
+				iterator end()
+				{
+					refresh();
+					return current.end();
+				}
+
+				/// Number of matching Entities.
+				size_t size() const
+				{
+					return matcher->set.size();
+				}
+			};
+
+			// Groups
+
+			/*! Group
+			 *
+			 * A handle to an owning group: the Entities having every owned
+			 * component, packed at the front of the owned pools in the same
+			 * order. Iterating a Group walks plain arrays, without any lookup.
+			 *
+			 * Writes through a Group are not tracked; use touch().
+			 *
+			 * @warning
+			 * Creating or erasing owned components reorders the Group.
+			 *
+			 * @tparam Ts Owned component types.
+			 */
+			template<typename... Ts>
+			class Group
+			{
+				friend class Database;
+
+				Database* db = nullptr;
+				GroupData* data = nullptr;
+
+				Group(Database* d, GroupData* g) : db(d), data(g)
+				{ }
+
+				template<typename Func, typename... Coms>
+				static auto call(int, Func& func, EntID eid, Coms& ... coms) -> decltype(func(eid, coms...), void())
+				{
+					func(eid, coms...);
+				}
+
+				template<typename Func, typename... Coms>
+				static void call(long, Func& func, EntID, Coms& ... coms)
+				{
+					func(coms...);
+				}
+
+			public:
+				Group() = default;
+
+				/// Number of Entities in the Group.
+				size_t size() const
+				{
+					return data ? data->size : 0;
+				}
+
+				/*! Owned components, in Group order.
+				 *
+				 * @tparam T Owned component type.
+				 * @return Array of size() components.
+				 */
+				template<typename T>
+				T* raw() const
+				{
+					static_assert(ListContains<TypeList<Ts...>, T>::value, "Component not owned by this Group");
+					return db->template pool<T>()->data();
+				}
+
+				/*! Call a function for each Entity of the Group.
+				 *
+				 * The function is called as `func(Ts&...)`, or as
+				 * `func(EntID, Ts&...)` if it accepts it.
+				 *
+				 * @param func Function to call.
+				 */
+				template<typename Func>
+				void each(Func&& func) const
+				{
+					if (!data)
+						return;
+
+					auto coms = make_tuple(raw<Ts>()...);
+					auto entities = data->pools[0]->entities();
+
+					for (size_t i = 0, e = data->size; i < e; ++i)
+						call(0, func, db->slots.id_at(entities[i]), std::get<Ts*>(coms)[i]...);
+				}
+
+				/*! Sort the Group.
+				 *
+				 * Equivalent to `sort<T>(cmp)` on the Database.
+				 *
+				 * @tparam T Owned component type to compare.
+				 * @param cmp Strict weak ordering of `T const&`.
+				 */
+				template<typename T, typename Compare>
+				void sort(Compare cmp) const
+				{
+					static_assert(ListContains<TypeList<Ts...>, T>::value, "Component not owned by this Group");
+					db->template sort<T>(move(cmp));
+				}
+			};
+		};
+
+	} // namespace _detail
+} // namespace ginseng
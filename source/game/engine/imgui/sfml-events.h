@@ -9,7 +9,6 @@ namespace ImGui
 {
     namespace ImImpl
     {
-        static sf::Clock ImImpl_timeElapsed;
         static bool ImImpl_mousePressed[5] = { false, false, false, false, false };
         static sf::Window* ImImpl_window;
     }
@@ -82,16 +81,12 @@ namespace ImGui
             io.KeyMap[ImGuiKey_X] = sf::Keyboard::X;
             io.KeyMap[ImGuiKey_Y] = sf::Keyboard::Y;
             io.KeyMap[ImGuiKey_Z] = sf::Keyboard::Z;
-            ImImpl::ImImpl_timeElapsed.restart();
         }
 
-        static void UpdateImGui()
+        static void UpdateImGui(float delta_time)
         {
             ImGuiIO& io = ImGui::GetIO();
-            static double time = 0.0f;
-            const double current_time = ImImpl::ImImpl_timeElapsed.getElapsedTime().asSeconds();
-            io.DeltaTime = (float)(current_time - time);
-            time = current_time;
+            io.DeltaTime = delta_time > 0.0f ? delta_time : 1.0f / 60.0f;
             sf::Vector2i mouse = sf::Mouse::getPosition(*ImImpl::ImImpl_window);
             io.MousePos = ImVec2((float)mouse.x, (float)mouse.y);
             io.MouseDown[0] = ImImpl::ImImpl_mousePressed[0] || sf::Mouse::isButtonPressed(sf::Mouse::Left);
@@ -22,7 +22,7 @@ public:
 
 	virtual void update(Seconds) override;
 
-	virtual void render() override;
+	virtual void render(float alpha) override;
 
 protected:
 	ginseng::Database<> _db;
@@ -40,6 +40,7 @@ public:
 	virtual void init(int argc, char** argv) override
 	{
 		Game::init(argc, argv);
+		set_update_rate(60);
 		_stack.push<TestState, PushType::PushWithoutPopping>();
 	}
 
@@ -59,9 +60,14 @@ public:
 		_stack.update(delta_time);
 	}
 
+	virtual void render(float alpha) override
+	{
+		Game::render(alpha);
+		_stack.render(alpha);
+	}
+
 	virtual void frame_end() override
 	{
-		_stack.render();
 		Game::frame_end();
 	}
 
@@ -106,6 +112,9 @@ void TestState::unload_resources()
 { }
 
 void TestState::update(Seconds)
+{ }
+
+void TestState::render(float)
 {
 	ImGui::Begin("Main", &_main_open, ImGuiWindowFlags_NoResize);
 	ImGui::Text("Hello, world!");
@@ -113,6 +122,3 @@ void TestState::update(Seconds)
 		game<TestGame>().quit(0);
 	ImGui::End();
 }
-
-void TestState::render()
-{ }
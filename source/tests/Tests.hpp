@@ -0,0 +1,12 @@
+#pragma once
+
+/// Reports a failed check; context names the storage or case under test
+void check(bool ok, char const* what, char const* context);
+
+void test_hierarchy();
+
+void test_pool_allocator();
+
+void test_entities();
+
+void test_snapshot();
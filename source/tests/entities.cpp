@@ -0,0 +1,69 @@
+#include <memory>
+
+#include "ginseng.hpp"
+
+#include "Tests.hpp"
+
+using namespace std;
+
+namespace
+{
+	struct Point
+	{
+		int x, y;
+	};
+
+	/// Erasing an Entity twice must not free its index twice
+	template<typename DB>
+	void double_erase(char const* storage)
+	{
+		DB db;
+
+		auto eid = db.create_entity();
+		db.create_component(eid, Point{1, 2});
+		db.erase_entity(eid);
+		db.erase_entity(eid);
+		check(db.size() == 0, "size after erasing twice", storage);
+
+		auto a = db.create_entity();
+		auto b = db.create_entity();
+		check(a.index() != b.index(), "distinct indices after erasing twice", storage);
+		check(db.size() == 2, "size after creating again", storage);
+	}
+
+	/// A stale EntID must not reach the Entity now using its index
+	template<typename DB>
+	void stale_erase(char const* storage)
+	{
+		DB db;
+
+		auto stale = db.create_entity();
+		db.erase_entity(stale);
+
+		auto fresh = db.create_entity();
+		db.create_component(fresh, Point{3, 4});
+		check(fresh.index() == stale.index(), "index reused", storage);
+		check(!db.valid(stale), "stale EntID invalid", storage);
+
+		db.erase_entity(stale);
+		check(db.valid(fresh), "new occupant kept", storage);
+
+		auto point = db.template get<Point>(fresh);
+		check(point && point.data().x == 3 && point.data().y == 4, "component of the new occupant kept", storage);
+		check(!db.template get<Point>(stale), "no component through a stale EntID", storage);
+	}
+
+	template<typename DB>
+	void run(char const* storage)
+	{
+		double_erase<DB>(storage);
+		stale_erase<DB>(storage);
+	}
+}
+
+void test_entities()
+{
+	run<ginseng::Database<>>("list");
+	run<ginseng::Database<allocator, ginseng::ArchetypeStorage>>("archetype");
+	run<ginseng::Database<allocator, ginseng::SparseStorage>>("sparse");
+}
@@ -0,0 +1,110 @@
+#include <memory>
+
+#include "ginseng.hpp"
+
+#include "Tests.hpp"
+
+using namespace std;
+
+namespace
+{
+	struct Local
+	{
+		int value;
+	};
+
+	struct World
+	{
+		int value;
+	};
+
+	World accumulate(World const* parent, Local const& local)
+	{
+		return {(parent ? parent->value : 0) + local.value};
+	}
+
+	/// An Entity erased from the Database directly, whose index is reused by a newly attached one
+	template<typename DB>
+	void reused_index(char const* storage)
+	{
+		DB db;
+		ginseng::Hierarchy<DB> h;
+
+		auto p = db.create_entity();
+		auto a = db.create_entity();
+		auto c = db.create_entity();
+		auto d = db.create_entity();
+		auto x = db.create_entity();
+
+		h.attach(a, p);
+		h.attach(c, p);
+		h.attach(d, a);
+		check(h.order(db).size() == 4, "order before erasing", storage);
+
+		db.erase_entity(a);
+		auto b = db.create_entity();
+		check(b.index() == a.index(), "index reused", storage);
+
+		h.attach(b, x);
+		check(h.order(db).size() == 5, "order after reusing the index", storage);
+		check(h.parent(c) == p, "sibling kept", storage);
+		check(h.parent(d) == ginseng::EntID{}, "orphan becomes a root", storage);
+		check(h.parent(b) == x, "new Entity attached", storage);
+	}
+
+	/// Cached component pointers follow structural changes of the Database
+	template<typename DB>
+	void propagate(char const* storage)
+	{
+		DB db;
+		ginseng::Hierarchy<DB> h;
+
+		auto root = db.create_entity();
+		auto child = db.create_entity();
+		h.attach(child, root);
+
+		for (auto eid : {root, child})
+		{
+			db.create_component(eid, Local{1});
+			db.create_component(eid, World{0});
+		}
+
+		h.template propagate<Local, World>(db, accumulate);
+		check(db.template get<World>(child).data().value == 2, "first pass", storage);
+
+		db.template get<Local>(root).data().value = 10;
+		h.template propagate<Local, World>(db, accumulate);
+		check(db.template get<World>(child).data().value == 11, "second pass", storage);
+
+		// Moves the components of the other Entities, in the archetype and sparse storages
+		for (int i = 0; i < 100; ++i)
+		{
+			auto eid = db.create_entity();
+			db.create_component(eid, Local{0});
+			db.create_component(eid, World{0});
+		}
+		db.erase_component(db.template get<World>(root).id());
+
+		h.template propagate<Local, World>(db, accumulate);
+		check(db.template get<World>(child).data().value == 1, "after structural changes", storage);
+
+		db.erase_entity(root);
+		h.template propagate<Local, World>(db, accumulate);
+		check(h.order(db).size() == 1, "erased parent dropped", storage);
+		check(db.template get<World>(child).data().value == 1, "after erasing the parent", storage);
+	}
+
+	template<typename DB>
+	void run(char const* storage)
+	{
+		reused_index<DB>(storage);
+		propagate<DB>(storage);
+	}
+}
+
+void test_hierarchy()
+{
+	run<ginseng::Database<>>("list");
+	run<ginseng::Database<allocator, ginseng::ArchetypeStorage>>("archetype");
+	run<ginseng::Database<allocator, ginseng::SparseStorage>>("sparse");
+}
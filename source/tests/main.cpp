@@ -0,0 +1,30 @@
+#include <cstdio>
+
+#include "Tests.hpp"
+
+namespace
+{
+	int failures = 0;
+}
+
+void check(bool ok, char const* what, char const* context)
+{
+	if (!ok)
+	{
+		std::printf("FAIL [%s] %s\n", context, what);
+		++failures;
+	}
+}
+
+int main()
+{
+	test_hierarchy();
+	test_pool_allocator();
+	test_entities();
+	test_snapshot();
+
+	if (failures == 0)
+		std::printf("All tests passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
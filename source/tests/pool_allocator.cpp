@@ -0,0 +1,55 @@
+#include "ginseng.hpp"
+
+#include "Tests.hpp"
+
+namespace
+{
+	struct Point
+	{
+		int x, y;
+	};
+
+	struct Bullet
+	{
+		float x, y;
+	};
+
+	using DB = ginseng::Database<ginseng::PoolAllocator, ginseng::SparseStorage>;
+
+	/// A live Database draws its arrays of a single element from the pools of trivial types
+	void reset_keeps_live_pools()
+	{
+		DB first;
+		auto eid = first.create_entity();
+		first.create_component(eid, Point{1, 1});
+
+		ginseng::reset_pools();
+
+		DB second;
+		second.create_component(second.create_entity(), Point{-7, -7});
+
+		auto point = first.get<Point>(eid);
+		check(point && point.data().x == 1 && point.data().y == 1, "component kept across reset_pools()", "sparse");
+	}
+
+	/// The explicit reset drops the live objects of a single pool
+	void reset_drops_objects()
+	{
+		using Allocator = ginseng::PoolAllocator<Bullet>;
+		Allocator alloc;
+
+		for (int i = 0; i < 100; ++i)
+			alloc.allocate(1);
+
+		check(Allocator::pool().size() == 100, "objects allocated", "PoolAllocator");
+
+		Allocator::reset();
+		check(Allocator::pool().size() == 0, "objects dropped", "PoolAllocator");
+	}
+}
+
+void test_pool_allocator()
+{
+	reset_keeps_live_pools();
+	reset_drops_objects();
+}
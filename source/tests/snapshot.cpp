@@ -0,0 +1,82 @@
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "ginseng.hpp"
+
+#include "Tests.hpp"
+
+using namespace std;
+
+namespace
+{
+	struct Point
+	{
+		int x, y;
+	};
+
+	/// Offset of the component count of the first section
+	constexpr size_t first_num = 32;
+
+	template<typename DB>
+	vector<unsigned char> saved(ginseng::Serializer<DB>& serializer)
+	{
+		DB db;
+		db.create_component(db.create_entity(), Point{1, 2});
+
+		vector<unsigned char> data;
+		serializer.save(db, data);
+		return data;
+	}
+
+	/// Corrupt snapshots are rejected before anything is created
+	template<typename DB>
+	void corrupt(char const* storage)
+	{
+		ginseng::Serializer<DB> serializer;
+		serializer.template register_component<Point>();
+
+		auto data = saved(serializer);
+
+		{
+			DB db;
+			check(serializer.load(db, data) && db.size() == 1, "valid snapshot loaded", storage);
+		}
+
+		{
+			auto bad = data;
+			uint64_t num = uint64_t(1) << 62;
+			memcpy(bad.data() + first_num, &num, sizeof(num));
+
+			DB db;
+			check(!serializer.load(db, bad), "huge component count rejected", storage);
+			check(db.size() == 0, "nothing created for a huge component count", storage);
+		}
+
+		{
+			auto bad = data;
+			uint32_t pos = 7;
+			memcpy(bad.data() + first_num + 16, &pos, sizeof(pos));
+
+			DB db;
+			check(!serializer.load(db, bad), "position out of range rejected", storage);
+			check(db.size() == 0, "nothing created for a position out of range", storage);
+		}
+
+		{
+			auto bad = data;
+			bad.pop_back();
+
+			DB db;
+			check(!serializer.load(db, bad), "truncated snapshot rejected", storage);
+			check(db.size() == 0, "nothing created for a truncated snapshot", storage);
+		}
+	}
+}
+
+void test_snapshot()
+{
+	corrupt<ginseng::Database<>>("list");
+	corrupt<ginseng::Database<allocator, ginseng::ArchetypeStorage>>("archetype");
+	corrupt<ginseng::Database<allocator, ginseng::SparseStorage>>("sparse");
+}